@@ -0,0 +1,165 @@
+#ifndef BUS_HPP
+#define BUS_HPP
+
+#include <UtilitaryRS/BufferedInterface.hpp>
+#include <UtilitaryRS/Crc8.hpp>
+#include <UtilitaryRS/RsHandler.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// NOLINTBEGIN
+namespace Bench {
+
+/// \brief Часы, которыми управляет сам бенчмарк
+class FakeTime {
+public:
+	static std::chrono::milliseconds milliseconds()
+	{
+		return now;
+	}
+
+	static inline std::chrono::milliseconds now{0};
+};
+
+/// \brief Порт ноды на общей шине, каждый write/writev считается как один системный вызов
+class BusPort {
+public:
+	explicit BusPort(std::vector<uint8_t> &aLine) : line{aLine} {}
+
+	size_t write(const uint8_t *aData, size_t aLength)
+	{
+		++calls;
+		line.insert(line.end(), aData, aData + aLength);
+		return aLength;
+	}
+
+	size_t writev(const RS::TxSlice *aSlices, size_t aCount)
+	{
+		++calls;
+		size_t length = 0;
+
+		for (size_t i = 0; i < aCount; ++i) {
+			line.insert(line.end(), aSlices[i].data, aSlices[i].data + aSlices[i].length);
+			length += aSlices[i].length;
+		}
+
+		return length;
+	}
+
+	size_t calls{0};
+
+private:
+	std::vector<uint8_t> &line;
+};
+
+/// \brief Слейв, отвечающий на запрос 2 четырьмя байтами
+template<typename Interface>
+class BusDevice : public RS::RsHandler<Interface, Crc8, 256> {
+	using Base = RS::RsHandler<Interface, Crc8, 256>;
+
+public:
+	BusDevice(const char *aName, const RS::DeviceVersion &aVersion, uint8_t aUID, Interface &aInterface) :
+		Base{aName, aVersion, aUID, aInterface}
+	{ }
+
+	RS::Result processBlobRequest(uint8_t aTransmitUID, uint8_t aMessageNumber, uint8_t aRequest,
+		uint8_t aRequestedDataSize) override
+	{
+		if (aRequest == 2 && aRequestedDataSize == 4) {
+			uint32_t payload = 0xAABBCCDDu;
+			return this->sendAnswer(aTransmitUID, aMessageNumber, aRequest, aRequestedDataSize, &payload, sizeof(payload))
+				? RS::Result::Ok
+				: RS::Result::Error;
+		}
+		return RS::Result::Unsupported;
+	}
+
+	RS::Result handleCommand(uint8_t, uint8_t) override
+	{
+		return RS::Result::Ok;
+	}
+};
+
+/// \brief Шина: линия мастер -> слейвы, линия слейвы -> мастер и набор слейвов со своими портами
+class Bus {
+public:
+	using Device = BusDevice<BusPort>;
+
+	explicit Bus(size_t aDevices)
+	{
+		const RS::DeviceVersion version{};
+		names.reserve(aDevices);
+
+		for (size_t i = 0; i < aDevices; ++i) {
+			names.push_back("dev" + std::to_string(i + 1));
+			ports.push_back(std::make_unique<BusPort>(up));
+			devices.push_back(std::make_unique<Device>(names.back().c_str(), version, static_cast<uint8_t>(i + 1), *ports.back()));
+		}
+	}
+
+	/// \brief Доставить все, что мастер отправил, всем слейвам
+	/// \return количество доставленных байт
+	size_t deliverDown()
+	{
+		const std::vector<uint8_t> data = std::move(down);
+		down.clear();
+
+		for (auto &device : devices) { device->update(data.data(), data.size()); }
+		return data.size();
+	}
+
+	/// \brief Доставить мастеру все ответы слейвов
+	template<typename Master>
+	size_t deliverUp(Master &aMaster)
+	{
+		const std::vector<uint8_t> data = std::move(up);
+		up.clear();
+
+		aMaster.update(data.data(), data.size());
+		return data.size();
+	}
+
+	std::vector<uint8_t> down;
+	std::vector<uint8_t> up;
+	std::vector<std::string> names;
+	std::vector<std::unique_ptr<BusPort>> ports;
+	std::vector<std::unique_ptr<Device>> devices;
+};
+
+/// \brief Зарегистрировать все устройства шины в хабе по одному и поставить им опрос запроса 2
+/// \return количество устройств, для которых создан опрос
+template<typename Hub>
+size_t registerDevices(Hub &aHub, Bus &aBus, std::chrono::milliseconds aPeriod)
+{
+	size_t registered = 0;
+
+	for (size_t i = 1; i <= aBus.devices.size(); ++i) {
+		aHub.sendProbe(static_cast<uint8_t>(i));
+		aHub.flush();
+		aBus.deliverDown();
+		aBus.deliverUp(aHub);
+
+		// Дальше хаб запрашивает информацию об устройстве
+		FakeTime::now += std::chrono::milliseconds{1000};
+		aHub.process(FakeTime::now);
+		aBus.deliverDown();
+		aBus.deliverUp(aHub);
+		aBus.deliverDown();
+	}
+
+	for (const auto &name : aBus.names) {
+		registered += aHub.createSchedRequest(name, 2, 4, aPeriod);
+	}
+
+	return registered;
+}
+
+} // namespace Bench
+// NOLINTEND
+
+#endif // BUS_HPP
@@ -0,0 +1,111 @@
+#ifndef TRAFFIC_HPP
+#define TRAFFIC_HPP
+
+#include <UtilitaryRS/RsParser.hpp>
+#include <UtilitaryRS/RsTypes.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string.h>
+#include <vector>
+
+// NOLINTBEGIN
+namespace Bench {
+
+/// \brief Добавить в поток кадр, собранный парсером из заголовка и (опционально) хвоста переменной длины
+template<typename Parser, typename Message>
+void appendFrame(std::vector<uint8_t> &aStream, const Message &aMessage, const void *aTail = nullptr, size_t aTailSize = 0)
+{
+	uint8_t raw[512];
+	uint8_t frame[512];
+
+	memcpy(raw, &aMessage, sizeof(aMessage));
+	if (aTailSize) {
+		memcpy(raw + sizeof(aMessage), aTail, aTailSize);
+	}
+
+	Parser parser;
+	const size_t length = parser.create(frame, raw, sizeof(aMessage) + aTailSize);
+	aStream.insert(aStream.end(), frame, frame + length);
+}
+
+/// \brief Сгенерировать трафик, похожий на ParserTest: смесь коротких и длинных кадров
+template<typename Parser>
+std::vector<uint8_t> makeTraffic(size_t aCycles)
+{
+	std::vector<uint8_t> stream;
+
+	for (size_t i = 0; i < aCycles; ++i) {
+		const uint8_t number = static_cast<uint8_t>(i);
+
+		RS::AckMessage ack{};
+		ack.receiverUID = 0x00;
+		ack.transmitUID = 0x01;
+		ack.messageType = RS::MessageType::Ack;
+		ack.number = number;
+		appendFrame<Parser>(stream, ack);
+
+		RS::ComMessage command{};
+		command.receiverUID = 0x01;
+		command.transmitUID = 0x00;
+		command.messageType = RS::MessageType::Command;
+		command.number = number;
+		command.payload.command = 0x06;
+		command.payload.value = 0x07;
+		appendFrame<Parser>(stream, command);
+
+		RS::HealthAnwMessage health{};
+		health.receiverUID = 0x00;
+		health.transmitUID = 0x01;
+		health.messageType = RS::MessageType::HealthAnw;
+		health.number = number;
+		health.payload.health = RS::Health::Healhy;
+		health.payload.flags = 7;
+		appendFrame<Parser>(stream, health);
+
+		const uint32_t blob = 0xAABBCCDDu;
+		RS::BlobAnwMessage answer{};
+		answer.receiverUID = 0x00;
+		answer.transmitUID = 0x01;
+		answer.messageType = RS::MessageType::BlobAnswer;
+		answer.number = number;
+		answer.payload.request = 0x02;
+		answer.payload.dataSize = sizeof(blob);
+		appendFrame<Parser>(stream, answer, &blob, sizeof(blob));
+
+		uint8_t chunk[128];
+		for (size_t j = 0; j < sizeof(chunk); ++j) { chunk[j] = static_cast<uint8_t>(j + i); }
+		RS::FileWriteChunkMessage write{};
+		write.receiverUID = 0x01;
+		write.transmitUID = 0x00;
+		write.messageType = RS::MessageType::FileWriteChunk;
+		write.number = number;
+		write.payload.fileNum = 1;
+		write.payload.chunkSize = sizeof(chunk);
+		appendFrame<Parser>(stream, write, chunk, sizeof(chunk));
+	}
+
+	return stream;
+}
+
+/// \brief Замер времени выполнения функции в секундах
+template<typename F>
+double measure(F &&aFunction)
+{
+	const auto start = std::chrono::steady_clock::now();
+	aFunction();
+	const auto stop = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(stop - start).count();
+}
+
+inline void report(const char *aName, double aBytes, double aSeconds)
+{
+	std::cout << aName << ": " << (aBytes / aSeconds / 1e6) << " MB/s" << std::endl;
+}
+
+} // namespace Bench
+// NOLINTEND
+
+#endif // TRAFFIC_HPP
@@ -0,0 +1,71 @@
+#include "Common/Traffic.hpp"
+#include <UtilitaryRS/Crc64.hpp>
+#include <UtilitaryRS/Crc64Parallel.hpp>
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// NOLINTBEGIN
+template<typename F>
+uint64_t run(const char *aName, std::vector<uint8_t> &aImage, size_t aRepeats, F &&aCrc)
+{
+	uint64_t crc = 0;
+
+	const double seconds = Bench::measure([&]() {
+		for (size_t r = 0; r < aRepeats; ++r) {
+			// Меняем образ между повторами, чтобы компилятор не вынес расчет из цикла
+			aImage[r] ^= 0x01;
+			crc ^= aCrc(aImage.data(), aImage.size());
+			aImage[r] ^= 0x01;
+		}
+	});
+
+	std::cout << aName << ": " << static_cast<double>(aImage.size() * aRepeats) / seconds / 1e9 << " GB/s" << std::endl;
+	return crc;
+}
+
+int main()
+{
+	// Образ прошивки в 16 МБ
+	std::vector<uint8_t> image(16 * 1024 * 1024);
+	std::mt19937 rng{7};
+	for (auto &byte : image) { byte = static_cast<uint8_t>(rng()); }
+
+	const uint64_t bytes = run("Crc64 byte table", image, 8, [](const uint8_t *aData, size_t aLength) {
+		return Crc64::updateBytes(0, aData, aLength);
+	});
+	const uint64_t slice8 = run("Crc64 slice-by-8", image, 8, [](const uint8_t *aData, size_t aLength) {
+		return Crc64::updateSlice8(0, aData, aLength);
+	});
+	const uint64_t slice16 = run("Crc64 slice-by-16", image, 8, [](const uint8_t *aData, size_t aLength) {
+		return Crc64::updateSlice16(0, aData, aLength);
+	});
+	const uint64_t clmul = !Crc64::hasClmul() ? bytes
+		: run("Crc64 carry-less multiply", image, 8, [](const uint8_t *aData, size_t aLength) {
+			  return Crc64::updateClmul(0, aData, aLength);
+		  });
+	const uint64_t calculate = run("Crc64::calculate", image, 8, [](const uint8_t *aData, size_t aLength) {
+		return Crc64::calculate(aData, aLength);
+	});
+	const uint64_t parallel = run("Crc64Parallel, all cores", image, 8, [](const uint8_t *aData, size_t aLength) {
+		return Crc64Parallel::calculate(aData, aLength);
+	});
+
+	// Образ в 2 МБ, всего две части: здесь заметна цена раздачи частей потокам
+	std::vector<uint8_t> small(image.begin(), image.begin() + 2 * 1024 * 1024);
+	const uint64_t smallCrc = run("Crc64::calculate, 2 MB", small, 256, [](const uint8_t *aData, size_t aLength) {
+		return Crc64::calculate(aData, aLength);
+	});
+	const uint64_t smallParallel = run("Crc64Parallel, 2 MB", small, 256, [](const uint8_t *aData, size_t aLength) {
+		return Crc64Parallel::calculate(aData, aLength);
+	});
+
+	// Все варианты считают одно и то же
+	const bool success = bytes == slice8 && bytes == slice16 && bytes == clmul && bytes == calculate && bytes == parallel
+		&& smallCrc == smallParallel;
+
+	return success ? 0 : 1;
+}
+// NOLINTEND
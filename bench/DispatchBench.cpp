@@ -0,0 +1,166 @@
+#include "Common/Traffic.hpp"
+#include <UtilitaryRS/BlobSource.hpp>
+#include <UtilitaryRS/Crc8.hpp>
+#include <UtilitaryRS/RsHandler.hpp>
+#include <UtilitaryRS/RsStaticHandler.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// NOLINTBEGIN
+/// \brief Интерфейс, отбрасывающий все, что в него пишут
+class NullSerial {
+public:
+	size_t write(const uint8_t *, size_t aLength)
+	{
+		sent += aLength;
+		return aLength;
+	}
+
+	size_t sent{0};
+};
+
+struct Counters {
+	size_t acks{0};
+	size_t commands{0};
+};
+
+class VirtualNode : public RS::RsHandler<NullSerial, Crc8, 64> {
+public:
+	VirtualNode(const RS::DeviceVersion &aVersion, NullSerial &aSerial) : RS::RsHandler<NullSerial, Crc8, 64>("Node", aVersion, 0x01, aSerial) {}
+
+	void handleAck(uint8_t, uint8_t aNumber, RS::Result) override
+	{
+		counters.acks += aNumber;
+	}
+
+	RS::Result handleCommand(uint8_t aCommand, uint8_t) override
+	{
+		counters.commands += 1u + aCommand;
+		return RS::Result::Ok;
+	}
+
+	Counters counters;
+};
+
+class StaticNode : public RS::RsStaticHandler<StaticNode, NullSerial, Crc8, 64> {
+public:
+	StaticNode(const RS::DeviceVersion &aVersion, NullSerial &aSerial) : RsStaticHandler("Node", aVersion, 0x01, aSerial) {}
+
+	void handleAck(uint8_t, uint8_t aNumber, RS::Result)
+	{
+		counters.acks += aNumber;
+	}
+
+	RS::Result handleCommand(uint8_t aCommand, uint8_t)
+	{
+		counters.commands += 1u + aCommand;
+		return RS::Result::Ok;
+	}
+
+	Counters counters;
+};
+
+/// \brief Датчик, отвечающий на запрос 16 байтами: сборка ответа на каждый запрос или заготовка BlobSource
+template<bool UseSource>
+class SensorNode : public RS::RsStaticHandler<SensorNode<UseSource>, NullSerial, Crc8, 64> {
+	using Base = RS::RsStaticHandler<SensorNode<UseSource>, NullSerial, Crc8, 64>;
+
+public:
+	SensorNode(const RS::DeviceVersion &aVersion, NullSerial &aSerial) : Base("Node", aVersion, 0x01, aSerial), source{0x01, 0x00}
+	{
+		source.publish(data);
+	}
+
+	RS::Result processBlobRequest(uint8_t aTransmitUID, uint8_t aMessageNumber, uint8_t aRequest, uint8_t aRequestedDataSize)
+	{
+		counters.commands += aMessageNumber;
+
+		if constexpr (UseSource) {
+			return Base::sendAnswer(aTransmitUID, aMessageNumber, aRequestedDataSize, source) ? RS::Result::Ok : RS::Result::InvalidArg;
+		} else {
+			return Base::sendAnswer(aTransmitUID, aMessageNumber, aRequest, aRequestedDataSize, data, sizeof(data))
+				? RS::Result::Ok : RS::Result::InvalidArg;
+		}
+	}
+
+	Counters counters;
+
+private:
+	uint8_t data[16]{};
+	RS::BlobSource<Crc8, sizeof(data)> source;
+};
+
+/// \brief Поток кадров одного типа, адресованных ноде 0x01
+template<typename Message>
+std::vector<uint8_t> makeStream(RS::MessageType aType, size_t aFrames)
+{
+	std::vector<uint8_t> stream;
+
+	for (size_t i = 0; i < aFrames; ++i) {
+		Message message{};
+		message.receiverUID = 0x01;
+		message.transmitUID = 0x00;
+		message.messageType = aType;
+		message.number = static_cast<uint8_t>(i);
+		Bench::appendFrame<RS::RsParser<64, Crc8>>(stream, message);
+	}
+
+	return stream;
+}
+
+template<typename Node>
+Counters run(const char *aName, const std::vector<uint8_t> &aStream, size_t aFrames)
+{
+	constexpr size_t kRepeats = 50;
+	constexpr size_t kRuns = 7;
+	const RS::DeviceVersion version{};
+	NullSerial serial;
+	Node node{version, serial};
+	double seconds = 0;
+
+	// Разница между вариантами порядка наносекунды, поэтому берем лучший из нескольких замеров
+	for (size_t run = 0; run < kRuns; ++run) {
+		const double elapsed = Bench::measure([&]() {
+			for (size_t r = 0; r < kRepeats; ++r) { node.update(aStream.data(), aStream.size()); }
+		});
+		seconds = run == 0 ? elapsed : std::min(seconds, elapsed);
+	}
+
+	std::cout << aName << ": " << seconds * 1e9 / static_cast<double>(aFrames * kRepeats) << " ns per frame" << std::endl;
+	// Счетчики одного прогона, чтобы их можно было сравнивать между вариантами
+	node.counters.acks /= kRuns;
+	node.counters.commands /= kRuns;
+	return node.counters;
+}
+
+int main()
+{
+	constexpr size_t kFrames = 100000;
+	const auto acks = makeStream<RS::AckMessage>(RS::MessageType::Ack, kFrames);
+	const auto commands = makeStream<RS::ComMessage>(RS::MessageType::Command, kFrames);
+
+	const Counters virtualAcks = run<VirtualNode>("Ack frames, virtual dispatch", acks, kFrames);
+	const Counters staticAcks = run<StaticNode>("Ack frames, static dispatch", acks, kFrames);
+	const Counters virtualCommands = run<VirtualNode>("Command frames with Ack reply, virtual dispatch", commands, kFrames);
+	const Counters staticCommands = run<StaticNode>("Command frames with Ack reply, static dispatch", commands, kFrames);
+
+	std::vector<uint8_t> requests;
+
+	for (size_t i = 0; i < kFrames; ++i) {
+		RS::BlobReqMessage message{{0x01, 0x00, RS::MessageType::BlobRequest, static_cast<uint8_t>(i)}, {0x00, 16}};
+		Bench::appendFrame<RS::RsParser<64, Crc8>>(requests, message);
+	}
+
+	const Counters copyAnswers = run<SensorNode<false>>("BlobRequest with 16 byte answer, sendAnswer", requests, kFrames);
+	const Counters sourceAnswers = run<SensorNode<true>>("BlobRequest with 16 byte answer, BlobSource", requests, kFrames);
+
+	const bool success = virtualAcks.acks == staticAcks.acks && virtualAcks.acks != 0
+		&& virtualCommands.commands == staticCommands.commands && virtualCommands.commands != 0
+		&& copyAnswers.commands == sourceAnswers.commands && copyAnswers.commands != 0;
+
+	return success ? 0 : 1;
+}
+// NOLINTEND
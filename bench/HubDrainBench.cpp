@@ -0,0 +1,142 @@
+#include "Common/Bus.hpp"
+#include <UtilitaryRS/Crc64.hpp>
+#include <UtilitaryRS/Crc8.hpp>
+#include <UtilitaryRS/DeviceHub.hpp>
+
+#include <cstdint>
+#include <iostream>
+
+// NOLINTBEGIN
+constexpr size_t kCommands = 50;
+
+/// \brief Наблюдатель-политика, считающий результаты команд
+class CommandCounter {
+public:
+	void onAckNotReceived(const RS::DeviceEvent &, RS::MessageType) {}
+	void onAckReceived(const RS::DeviceEvent &, RS::MessageType, RS::Result) {}
+
+	void onCommandResult(const RS::DeviceEvent &, RS::Result)
+	{
+		++results;
+	}
+
+	void onRequestError(const RS::DeviceEvent &, RS::Result) {}
+
+	RS::Result onBlobAnswer(const RS::DeviceEvent &, uint8_t, const void *, size_t)
+	{
+		return RS::Result::Ok;
+	}
+
+	void onDeviceRegistered(const RS::DeviceEvent &, RS::DeviceVersion) {}
+	void onDeviceLost(const RS::DeviceEvent &) {}
+
+	RS::Result onFileWriteResult(const RS::DeviceEvent &, RS::Result aReturn)
+	{
+		return aReturn;
+	}
+
+	void onDeviceHealth(const RS::DeviceEvent &, RS::Health, uint16_t) {}
+
+	size_t results{0};
+};
+
+/// \brief Время на шине: каждый байт занимает 10 бит (старт, 8 бит данных, стоп)
+class Wire {
+public:
+	explicit Wire(double aBaud) : baud{aBaud}, micros{static_cast<double>(Bench::FakeTime::now.count()) * 1000.0} {}
+
+	void transfer(size_t aBytes)
+	{
+		micros += static_cast<double>(aBytes) * 10.0 * 1e6 / baud;
+		sync();
+	}
+
+	void waitUntil(std::chrono::milliseconds aTime)
+	{
+		micros = std::max(micros, static_cast<double>(aTime.count()) * 1000.0);
+		sync();
+	}
+
+	double elapsed(double aStart) const
+	{
+		return (micros - aStart) / 1000.0;
+	}
+
+	double now() const
+	{
+		return micros;
+	}
+
+private:
+	double baud;
+	double micros;
+
+	void sync()
+	{
+		Bench::FakeTime::now = std::chrono::milliseconds{static_cast<int64_t>(micros / 1000.0)};
+	}
+};
+
+/// \brief Поставить kCommands команд одному устройству и дождаться всех результатов
+/// \return время опустошения очереди в мс по времени шины, отрицательное при ошибке
+double drain(double aBaud, std::chrono::milliseconds aSendInterval)
+{
+	using Hub = RS::DeviceHub<2, Bench::BusPort, Bench::FakeTime, Crc8, Crc64, 256, CommandCounter>;
+
+	const RS::DeviceVersion version{};
+	Bench::Bus bus{1};
+	Bench::BusPort port{bus.down};
+	Hub hub{version, port};
+	CommandCounter counter;
+	hub.registerObserver(&counter);
+	hub.setSendInterval(aSendInterval);
+
+	// Редкая телеметрия, чтобы очередь команд делила шину с обычным опросом
+	if (Bench::registerDevices(hub, bus, std::chrono::milliseconds{1000}) != 1) {
+		return -1;
+	}
+
+	const auto device = hub.findDevice(bus.names.front());
+	Wire wire{aBaud};
+	wire.transfer(bus.deliverUp(hub));
+	wire.transfer(bus.deliverDown());
+
+	const double start = wire.now();
+
+	for (size_t i = 0; i < kCommands; ++i) { hub.sendCmdToDevice(device, 1, static_cast<uint8_t>(i)); }
+
+	while (counter.results < kCommands) {
+		const auto deadline = hub.process(Bench::FakeTime::now);
+
+		if (bus.down.empty() && bus.up.empty()) {
+			if (deadline == Hub::kNoDeadline) {
+				return -1;
+			}
+			wire.waitUntil(deadline);
+			continue;
+		}
+
+		wire.transfer(bus.deliverDown());
+		// Ответ слейва, по Ack на него хаб сразу отправляет следующее сообщение
+		wire.transfer(bus.deliverUp(hub));
+	}
+
+	return wire.elapsed(start);
+}
+
+int main()
+{
+	bool success = true;
+
+	for (const double baud : {115200.0, 1000000.0}) {
+		const double clocked = drain(baud, std::chrono::milliseconds{0});
+		const double limited = drain(baud, std::chrono::milliseconds{100});
+		success &= clocked > 0 && limited > 0;
+
+		std::cout << static_cast<int>(baud) << " baud, " << kCommands << " commands: ack-clocked " << clocked
+				  << " ms, 100 ms interval " << limited << " ms" << std::endl;
+	}
+
+	return success ? 0 : 1;
+}
+// NOLINTEND
@@ -0,0 +1,99 @@
+#include "Common/Bus.hpp"
+#include "Common/Traffic.hpp"
+#include <UtilitaryRS/Crc64.hpp>
+#include <UtilitaryRS/Crc8.hpp>
+#include <UtilitaryRS/DeviceHub.hpp>
+
+#include <cstdint>
+#include <iostream>
+
+// NOLINTBEGIN
+constexpr size_t kDevices = 250;
+constexpr size_t kTicks = 2000;
+
+/// \brief Наблюдатель-политика: события по UID без строк и виртуальных вызовов
+class TelemetryCounter {
+public:
+	void onAckNotReceived(const RS::DeviceEvent &, RS::MessageType) {}
+	void onAckReceived(const RS::DeviceEvent &, RS::MessageType, RS::Result) {}
+	void onCommandResult(const RS::DeviceEvent &, RS::Result) {}
+	void onRequestError(const RS::DeviceEvent &, RS::Result) {}
+
+	RS::Result onBlobAnswer(const RS::DeviceEvent &aDevice, uint8_t, const void *, size_t)
+	{
+		++answers[aDevice.handle.uid];
+		return RS::Result::Ok;
+	}
+
+	void onDeviceRegistered(const RS::DeviceEvent &, RS::DeviceVersion) {}
+	void onDeviceLost(const RS::DeviceEvent &) {}
+
+	RS::Result onFileWriteResult(const RS::DeviceEvent &, RS::Result aReturn)
+	{
+		return aReturn;
+	}
+
+	void onDeviceHealth(const RS::DeviceEvent &, RS::Health, uint16_t) {}
+
+	size_t answers[256]{};
+};
+
+int main()
+{
+	using Hub = RS::DeviceHub<kDevices + 1, Bench::BusPort, Bench::FakeTime, Crc8, Crc64, 256, TelemetryCounter>;
+
+	const RS::DeviceVersion version{};
+	Bench::Bus bus{kDevices};
+	Bench::BusPort port{bus.down};
+	Hub hub{version, port};
+	TelemetryCounter counter;
+	hub.registerObserver(&counter);
+
+	if (Bench::registerDevices(hub, bus, std::chrono::milliseconds{100}) != kDevices) {
+		std::cout << "Registration failed" << std::endl;
+		return 1;
+	}
+
+	double processSeconds = 0;
+	double answerSeconds = 0;
+	size_t answerBytes = 0;
+
+	// Такт 1 мс: большую часть вызовов process() устройствам делать нечего, раз в 100 мс каждое опрашивается
+	for (size_t tick = 0; tick < kTicks; ++tick) {
+		Bench::FakeTime::now += std::chrono::milliseconds{1};
+		processSeconds += Bench::measure([&]() { hub.process(Bench::FakeTime::now); });
+		bus.deliverDown();
+		answerBytes += bus.up.size();
+		answerSeconds += Bench::measure([&]() { bus.deliverUp(hub); });
+		bus.deliverDown();
+	}
+
+	std::cout << kDevices << " devices, process(): " << processSeconds * 1e6 / kTicks << " us per call" << std::endl;
+	std::cout << kDevices << " devices, answers to hub: " << answerSeconds * 1e9 / static_cast<double>(answerBytes)
+			  << " ns per byte" << std::endl;
+
+	// Тот же интервал, но process() вызывается только к возвращенному сроку
+	const auto end = Bench::FakeTime::now + std::chrono::milliseconds{kTicks};
+	size_t wakeups = 0;
+	auto deadline = hub.process(Bench::FakeTime::now);
+
+	while (deadline < end) {
+		Bench::FakeTime::now = deadline;
+		deadline = hub.process(Bench::FakeTime::now);
+		bus.deliverDown();
+		bus.deliverUp(hub);
+		bus.deliverDown();
+		++wakeups;
+	}
+
+	std::cout << kDevices << " devices, deadline-driven: " << wakeups << " process() calls instead of " << kTicks
+			  << " ticks" << std::endl;
+
+	size_t answered = 0;
+
+	for (size_t uid = 1; uid <= kDevices; ++uid) { answered += counter.answers[uid] != 0; }
+
+	std::cout << answered << " of " << kDevices << " devices answered telemetry" << std::endl;
+	return answered == kDevices ? 0 : 1;
+}
+// NOLINTEND
@@ -0,0 +1,66 @@
+#include "Common/Bus.hpp"
+#include "Common/Traffic.hpp"
+#include <UtilitaryRS/BufferedInterface.hpp>
+#include <UtilitaryRS/Crc64.hpp>
+#include <UtilitaryRS/Crc8.hpp>
+#include <UtilitaryRS/DeviceHub.hpp>
+
+#include <cstdint>
+#include <iostream>
+
+// NOLINTBEGIN
+constexpr size_t kDevices = 100;
+constexpr size_t kTicks = 100;
+
+template<typename Hub, typename Port>
+bool run(const char *aName, Hub &aHub, Port &aPort, Bench::Bus &aBus)
+{
+	if (Bench::registerDevices(aHub, aBus, std::chrono::milliseconds{100}) != kDevices) {
+		std::cout << aName << ": registration failed" << std::endl;
+		return false;
+	}
+
+	const size_t callsBefore = aPort.calls;
+	size_t bytes = 0;
+
+	for (size_t tick = 0; tick < kTicks; ++tick) {
+		Bench::FakeTime::now += std::chrono::milliseconds{100};
+		aHub.process(Bench::FakeTime::now);
+		bytes += aBus.deliverDown();
+		// Ответы слейвов, Ack хаба на них и следующие запросы уходят из update() одной записью
+		aBus.deliverUp(aHub);
+		bytes += aBus.deliverDown();
+	}
+
+	const double calls = static_cast<double>(aPort.calls - callsBefore) / kTicks;
+	std::cout << aName << ": " << calls << " writes per tick, " << bytes / kTicks << " bytes per tick" << std::endl;
+	return true;
+}
+
+int main()
+{
+	using DirectHub = RS::DeviceHub<kDevices + 1, Bench::BusPort, Bench::FakeTime, Crc8, Crc64, 256>;
+	using Buffered = RS::BufferedInterface<Bench::BusPort, 4096>;
+	using BufferedHub = RS::DeviceHub<kDevices + 1, Buffered, Bench::FakeTime, Crc8, Crc64, 256>;
+
+	const RS::DeviceVersion version{};
+	bool success = true;
+
+	{
+		Bench::Bus bus{kDevices};
+		Bench::BusPort port{bus.down};
+		DirectHub hub{version, port};
+		success &= run("100 devices, write per frame", hub, port, bus);
+	}
+
+	{
+		Bench::Bus bus{kDevices};
+		Bench::BusPort port{bus.down};
+		Buffered buffered{port};
+		BufferedHub hub{version, buffered};
+		success &= run("100 devices, BufferedInterface", hub, port, bus);
+	}
+
+	return success ? 0 : 1;
+}
+// NOLINTEND
@@ -0,0 +1,100 @@
+#include "Common/Traffic.hpp"
+#include <UtilitaryRS/Crc8.hpp>
+#include <UtilitaryRS/RsParser.hpp>
+
+#include <cstdint>
+#include <iostream>
+
+// NOLINTBEGIN
+using Parser = RS::RsParser<512, Crc8>;
+
+/// \brief Классический цикл: update, обработка, reset - так раньше работали RsHandler и MultiNode
+size_t parseByUpdate(Parser &aParser, const std::vector<uint8_t> &aTraffic)
+{
+	size_t frames = 0;
+	size_t left = aTraffic.size();
+
+	while (left) {
+		const size_t parsed = aParser.update(aTraffic.data() + (aTraffic.size() - left), left);
+
+		if (parsed == 0) {
+			aParser.reset();
+			break;
+		}
+
+		left -= parsed;
+		if (aParser.isReady()) {
+			++frames;
+			aParser.reset();
+		}
+	}
+
+	return frames;
+}
+
+/// \brief Пакетный разбор всего буфера за один вызов
+size_t parseByBatch(Parser &aParser, const std::vector<uint8_t> &aTraffic)
+{
+	size_t frames = 0;
+	aParser.parse(aTraffic.data(), aTraffic.size(), [&frames](const uint8_t *, size_t) { ++frames; });
+	return frames;
+}
+
+/// \brief Только короткие кадры Ack и HealthAnw, как после DMA/epoll чтения на загруженном хабе
+std::vector<uint8_t> makeShortTraffic(size_t aCycles)
+{
+	std::vector<uint8_t> stream;
+
+	for (size_t i = 0; i < aCycles; ++i) {
+		RS::AckMessage ack{};
+		ack.transmitUID = static_cast<uint8_t>(i);
+		ack.messageType = RS::MessageType::Ack;
+		ack.number = static_cast<uint8_t>(i);
+		Bench::appendFrame<Parser>(stream, ack);
+
+		RS::HealthAnwMessage health{};
+		health.transmitUID = static_cast<uint8_t>(i);
+		health.messageType = RS::MessageType::HealthAnw;
+		health.number = static_cast<uint8_t>(i);
+		Bench::appendFrame<Parser>(stream, health);
+	}
+
+	return stream;
+}
+
+template<typename F>
+bool run(const char *aName, const std::vector<uint8_t> &aTraffic, size_t aExpected, F &&aParse, bool aFiltered = false)
+{
+	constexpr size_t kRepeats = 200;
+	Parser parser;
+	size_t frames = 0;
+
+	if (aFiltered) {
+		// Нода, которой в трафике нет, - как слейв на загруженной шине
+		parser.setReceiverFilter(0x05);
+	}
+
+	const double seconds = Bench::measure([&]() {
+		for (size_t r = 0; r < kRepeats; ++r) { frames += aParse(parser, aTraffic); }
+	});
+
+	Bench::report(aName, static_cast<double>(aTraffic.size() * kRepeats), seconds);
+	return frames == aExpected * kRepeats;
+}
+
+int main()
+{
+	const auto traffic = Bench::makeTraffic<Parser>(1000);
+	const auto shortTraffic = makeShortTraffic(5000);
+	bool success = true;
+
+	success &= run("Mixed traffic, RsParser::update", traffic, 5000, parseByUpdate);
+	success &= run("Mixed traffic, RsParser::parse", traffic, 5000, parseByBatch);
+	success &= run("Short frames, RsParser::update", shortTraffic, 10000, parseByUpdate);
+	success &= run("Short frames, RsParser::parse", shortTraffic, 10000, parseByBatch);
+	success &= run("Foreign traffic, RsParser::update with receiver filter", traffic, 0, parseByUpdate, true);
+	success &= run("Foreign traffic, RsParser::parse with receiver filter", traffic, 0, parseByBatch, true);
+
+	return success ? 0 : 1;
+}
+// NOLINTEND
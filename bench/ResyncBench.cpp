@@ -0,0 +1,79 @@
+#include "Common/Traffic.hpp"
+#include <UtilitaryRS/Crc8.hpp>
+#include <UtilitaryRS/RsParser.hpp>
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+
+// NOLINTBEGIN
+using Parser = RS::RsParser<512, Crc8>;
+
+/// \brief Поток из кадров, разбавленных случайным мусором до заданной доли
+std::vector<uint8_t> makeNoisyStream(double aGarbageShare, size_t aSize)
+{
+	const auto frames = Bench::makeTraffic<Parser>(100);
+	std::mt19937 rng{42};
+	std::uniform_int_distribution<int> byte{0, 255};
+	std::vector<uint8_t> stream;
+	stream.reserve(aSize + frames.size());
+
+	const size_t garbagePerFrameSet = aGarbageShare >= 1.0
+		? aSize
+		: static_cast<size_t>(static_cast<double>(frames.size()) * aGarbageShare / (1.0 - aGarbageShare));
+
+	while (stream.size() < aSize) {
+		for (size_t i = 0; i < garbagePerFrameSet && stream.size() < aSize; ++i) {
+			stream.push_back(static_cast<uint8_t>(byte(rng)));
+		}
+		if (aGarbageShare < 1.0) {
+			stream.insert(stream.end(), frames.begin(), frames.end());
+		}
+	}
+
+	return stream;
+}
+
+int main()
+{
+	constexpr size_t kStreamSize = 4 * 1024 * 1024;
+	constexpr size_t kReadSize = 4096;
+	constexpr size_t kRepeats = 10;
+
+	for (double share : {0.0, 0.5, 0.9, 0.99, 1.0}) {
+		const auto stream = makeNoisyStream(share, kStreamSize);
+		Parser parser;
+		size_t frames = 0;
+
+		const double seconds = Bench::measure([&]() {
+			for (size_t r = 0; r < kRepeats; ++r) {
+				// Имитируем чтение из порта кусками по kReadSize
+				for (size_t offset = 0; offset < stream.size(); offset += kReadSize) {
+					const size_t length = std::min(kReadSize, stream.size() - offset);
+					size_t left = length;
+
+					while (left) {
+						const size_t parsed = parser.update(stream.data() + offset + (length - left), left);
+
+						if (parsed == 0) {
+							parser.reset();
+							break;
+						}
+
+						left -= parsed;
+						if (parser.isReady()) {
+							++frames;
+							parser.reset();
+						}
+					}
+				}
+			}
+		});
+
+		std::cout << "Garbage " << static_cast<int>(share * 100) << "%, frames " << frames / kRepeats << ", ";
+		Bench::report("RsParser::update", static_cast<double>(stream.size() * kRepeats), seconds);
+	}
+
+	return 0;
+}
+// NOLINTEND
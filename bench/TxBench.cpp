@@ -0,0 +1,95 @@
+#include "Common/Traffic.hpp"
+#include <UtilitaryRS/Crc8.hpp>
+#include <UtilitaryRS/RsHandler.hpp>
+
+#include <cstdint>
+#include <iostream>
+
+// NOLINTBEGIN
+/// \brief Интерфейс с одним буфером отправки: write копирует сообщение в него, как драйвер UART с DMA
+class CopySerial {
+public:
+	size_t write(const uint8_t *aData, size_t aLength)
+	{
+		memcpy(slot, aData, aLength);
+		sent += aLength;
+		return aLength;
+	}
+
+	uint8_t slot[512];
+	size_t sent{0};
+};
+
+/// \brief Тот же буфер, но сообщение собирается прямо в нем
+class ReserveSerial : public CopySerial {
+public:
+	uint8_t *reserve(size_t aLength)
+	{
+		return aLength <= sizeof(slot) ? slot : nullptr;
+	}
+
+	void commit(size_t aLength)
+	{
+		sent += aLength;
+	}
+};
+
+template<typename Interface>
+bool run(const char *aName)
+{
+	constexpr size_t kChunks = 200000;
+	const RS::DeviceVersion version{};
+	uint8_t chunk[255];
+
+	for (size_t i = 0; i < sizeof(chunk); ++i) { chunk[i] = static_cast<uint8_t>(i); }
+
+	Interface serial;
+	RS::RsHandler<Interface, Crc8, 512> handler("Bench", version, 0x00, serial);
+
+	const double seconds = Bench::measure([&]() {
+		for (size_t i = 0; i < kChunks; ++i) {
+			chunk[0] = static_cast<uint8_t>(i);
+			handler.fileWriteChunk(0x01, 0x01, chunk, sizeof(chunk));
+		}
+	});
+
+	Bench::report(aName, static_cast<double>(kChunks * sizeof(chunk)), seconds);
+	return serial.sent == kChunks * (sizeof(chunk) + sizeof(RS::FileWriteChunkMessage) + 2);
+}
+
+/// \brief Опрос, как у хаба: Probe и HealthReq по всем UID
+template<typename Interface>
+bool runPolling(const char *aName)
+{
+	constexpr size_t kRounds = 20000;
+	const RS::DeviceVersion version{};
+
+	Interface serial;
+	RS::RsHandler<Interface, Crc8, 512> handler("Bench", version, 0x00, serial);
+
+	const double seconds = Bench::measure([&]() {
+		for (size_t i = 0; i < kRounds; ++i) {
+			for (uint8_t uid = 1; uid < 255; ++uid) {
+				handler.sendProbe(uid);
+				handler.sendHealthRequest(uid);
+			}
+		}
+	});
+
+	constexpr size_t kFrames = kRounds * 254 * 2;
+	std::cout << aName << ": " << seconds * 1e9 / kFrames << " ns per frame" << std::endl;
+	return serial.sent == kFrames * (sizeof(RS::ProbeMessage) + 2);
+}
+
+int main()
+{
+	bool success = true;
+
+	success &= run<CopySerial>("FileWriteChunk 255 bytes, write");
+	success &= run<ReserveSerial>("FileWriteChunk 255 bytes, reserve/commit");
+	success &= runPolling<CopySerial>("Probe/HealthReq, write");
+	success &= runPolling<ReserveSerial>("Probe/HealthReq, reserve/commit");
+
+	return success ? 0 : 1;
+}
+// NOLINTEND
@@ -0,0 +1,94 @@
+/*!
+\file
+\brief Заранее собранный ответ на BlobRequest, пересобираемый только при обновлении данных
+\author V-Nezlo (vlladimirka@gmail.com)
+\date 16.10.2026
+\version 1.0
+
+Датчики опрашиваются одними и теми же запросами намного чаще, чем меняются их данные. BlobSource хранит
+готовое сообщение BlobAnswer: копирование данных и подсчет CRC происходят в publish(), а ответ на запрос
+только подставляет получателя и номер, как FrameTemplate. publish() и ответ на запрос не должны выполняться
+одновременно (например, publish() из основного цикла, а update() из прерывания) - иначе уйдет наполовину
+обновленное сообщение
+*/
+
+#ifndef LIB_BLOBSOURCE_HPP
+#define LIB_BLOBSOURCE_HPP
+
+#include "FrameTemplate.hpp"
+#include "RsTypes.hpp"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace RS {
+
+/// \brief Сообщение BlobAnswer с данными постоянного размера
+template<size_t DataSize>
+struct BlobAnwFrame : public BlobAnwMessage {
+	uint8_t data[DataSize];
+} __attribute__((packed));
+
+/// \brief Источник данных для ответа на BlobRequest
+/// \tparam Crc CRC протокола, см. FrameTemplate
+/// \tparam DataSize размер данных ответа
+template<typename Crc, size_t DataSize>
+class BlobSource {
+	static_assert(DataSize > 0 && DataSize <= UINT8_MAX, "BlobSource data size must fit in BlobAnwPayload::dataSize");
+
+public:
+	using Message = BlobAnwFrame<DataSize>;
+	using Template = FrameTemplate<Crc, Message>;
+
+	/// \param aTransmitUID UID устройства, отвечающего на запрос
+	/// \param aRequest номер запроса, на который отвечает источник
+	BlobSource(uint8_t aTransmitUID, uint8_t aRequest) :
+		message{},
+		frameTemplate{prototype(aTransmitUID, aRequest)}
+	{ }
+
+	/// \brief Опубликовать новые данные, сообщение пересобирается сразу
+	/// \param aData указатель на DataSize байт данных
+	void publish(const void *aData)
+	{
+		memcpy(message.data, aData, DataSize);
+		frameTemplate.assign(message);
+	}
+
+	/// \return Номер запроса, на который отвечает источник
+	uint8_t request() const
+	{
+		return message.payload.request;
+	}
+
+	/// \return Размер данных ответа
+	static constexpr uint8_t dataSize()
+	{
+		return static_cast<uint8_t>(DataSize);
+	}
+
+	/// \return Заготовка сообщения с текущими данными
+	const Template &frame() const
+	{
+		return frameTemplate;
+	}
+
+private:
+	Message message;
+	Template frameTemplate;
+
+	/// \brief Сообщение с нулевыми данными, публикуемые данные пишутся в него же
+	Message &prototype(uint8_t aTransmitUID, uint8_t aRequest)
+	{
+		message.transmitUID = aTransmitUID;
+		message.messageType = MessageType::BlobAnswer;
+		message.payload.request = aRequest;
+		message.payload.dataSize = static_cast<uint8_t>(DataSize);
+		return message;
+	}
+};
+
+} // namespace RS
+
+#endif // LIB_BLOBSOURCE_HPP
@@ -0,0 +1,132 @@
+/*!
+\file
+\brief Обертка над интерфейсом, собирающая исходящие сообщения в один вызов write
+\author V-Nezlo (vlladimirka@gmail.com)
+\date 16.10.2026
+\version 1.0
+
+Каждый send* в RsHandler отдает интерфейсу одно короткое сообщение, на Linux это отдельный системный вызов write.
+Обертка копит сообщения в буфере и отдает их пачкой по flush(), при заполнении буфера, либо в конце такта
+RsHandler::update и DeviceHub::process
+*/
+
+#ifndef LIB_BUFFEREDINTERFACE_HPP
+#define LIB_BUFFEREDINTERFACE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include <utility>
+
+namespace RS {
+
+/// \brief Кусок данных для векторной записи
+struct TxSlice {
+	const uint8_t *data;
+	size_t length;
+};
+
+namespace Detail {
+
+/// \brief Проверка, умеет ли интерфейс векторную запись writev(const TxSlice *, size_t)
+template<typename T, typename = void>
+struct HasWritev : std::false_type {};
+
+template<typename T>
+struct HasWritev<T, std::void_t<decltype(std::declval<T &>().writev(std::declval<const TxSlice *>(), size_t{}))>>
+	: std::true_type {};
+
+} // namespace Detail
+
+/// \brief Буферизующая обертка над интерфейсом
+/// \tparam Interface интерфейс с write(const uint8_t *, size_t), опционально с writev(const TxSlice *, size_t)
+/// \tparam Size размер буфера, должен вмещать хотя бы одно сообщение максимального размера
+template<class Interface, size_t Size>
+class BufferedInterface {
+public:
+	/// \param aInterface интерфейс, в который уходят накопленные сообщения
+	BufferedInterface(Interface &aInterface) :
+		interface{aInterface},
+		used{0},
+		buffer{}
+	{ }
+
+	/// \brief Выдать область для сборки сообщения прямо в буфере, при нехватке места буфер сначала сбрасывается
+	/// \param aLength размер сообщения
+	/// \return область или nullptr, если сообщение больше буфера
+	uint8_t *reserve(size_t aLength)
+	{
+		if (aLength > Size) {
+			return nullptr;
+		}
+
+		if (Size - used < aLength) {
+			flush();
+		}
+
+		return buffer + used;
+	}
+
+	/// \brief Подтвердить сообщение, собранное в области из reserve
+	/// \param aLength размер сообщения
+	void commit(size_t aLength)
+	{
+		used += aLength;
+	}
+
+	/// \brief Добавить данные в буфер
+	/// \param aData данные
+	/// \param aLength размер данных
+	/// \return aLength
+	size_t write(const uint8_t *aData, size_t aLength)
+	{
+		if (Size - used >= aLength) {
+			memcpy(buffer + used, aData, aLength);
+			used += aLength;
+			return aLength;
+		}
+
+		if constexpr (Detail::HasWritev<Interface>::value) {
+			// Накопленное и новые данные уходят одним вызовом без копирования
+			const TxSlice slices[] = {{buffer, used}, {aData, aLength}};
+			interface.writev(used ? slices : slices + 1, used ? 2 : 1);
+			used = 0;
+			return aLength;
+		} else {
+			flush();
+
+			if (aLength > Size) {
+				return interface.write(aData, aLength);
+			}
+
+			memcpy(buffer, aData, aLength);
+			used = aLength;
+			return aLength;
+		}
+	}
+
+	/// \brief Отдать накопленные сообщения интерфейсу
+	void flush()
+	{
+		if (used) {
+			interface.write(buffer, used);
+			used = 0;
+		}
+	}
+
+	/// \return Количество накопленных байт
+	size_t pending() const
+	{
+		return used;
+	}
+
+private:
+	Interface &interface;
+	size_t used;
+	uint8_t buffer[Size];
+};
+
+} // namespace RS
+
+#endif // LIB_BUFFEREDINTERFACE_HPP
@@ -5,84 +5,178 @@
 \date 23.09.2025
 \version 2.0
 
+На x86-64 с PCLMULQDQ и на aarch64 с PMULL длинные буферы считаются сверткой через умножение без переносов,
+ядро выбирается при первом вызове по возможностям процессора, иначе используется slice-by-16.
+Аппаратные ядра можно отключить, определив UTILITARY_RS_CRC64_NO_CLMUL
+
+Результат не совпадает с Crc64::calculate версий до slice-by-16: прежняя таблица не соответствовала полиному.
+Для передачи файлов устройствам со старой прошивкой есть Crc64Legacy, порядок перехода описан в README
 */
 
 #ifndef LIB_CRC64_HPP_
 #define LIB_CRC64_HPP_
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
+#include <string.h>
+
+#if !defined(UTILITARY_RS_CRC64_NO_CLMUL) && (defined(__GNUC__) || defined(__clang__))
+#if defined(__x86_64__)
+#define UTILITARY_RS_CRC64_PCLMUL
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__linux__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define UTILITARY_RS_CRC64_PMULL
+#include <arm_neon.h>
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+#endif
 
 class Crc64 {
 	Crc64() = delete;
 	Crc64(const Crc64 &) = delete;
 	Crc64 &operator=(const Crc64 &) = delete;
 
-	static constexpr uint64_t table[]
-		= {0x0000000000000000ULL, 0x42F0E1EBA9EA3693ULL, 0x85E1C3D753D46D26ULL, 0xC711223CFA3E5BB5ULL,
-			0x4933F7ACB3C81A59ULL, 0x0BC316473A223CCBULL, 0xCCD2327BE01C774FULL, 0x8E22D39049F641DCULL,
-			0x9267EF59672734B3ULL, 0xD0970EB2CECD0220ULL, 0x17862C8E94F959A6ULL, 0x5576CD653D136F35ULL,
-			0xDB5418A2E4EF2EEAULL, 0x99A4F9494D051879ULL, 0x5EB5DB75173B43FDULL, 0x1C453A9EBED1756EULL,
-			0x668842B2B1868D55ULL, 0x2478A359186CBBE6ULL, 0xE369816542528060ULL, 0xA199608EEBB8B6F3ULL,
-			0x2FBBB51E0B7A970FULL, 0x6D4B54F5A290A19CULL, 0xAA5A76C9F8AEFA1AULL, 0xE8AA97225144CC89ULL,
-			0xF4EFABEB36A1B9E6ULL, 0xB61F4A009F4B8F75ULL, 0x710E683CC575D4F1ULL, 0x33FE89D76C9FE262ULL,
-			0xBDDC5C478C6DC39EULL, 0xFF2CBDAE2587F50DULL, 0x383D9F927FB9AE8BULL, 0x7ACD7E79D6539818ULL,
-			0xCD1050E7AC8D2FAAULL, 0x8FE0B10C05671939ULL, 0x48F193305F5932BDULL, 0x0A0172DBF6B3042EULL,
-			0x8423A74B166125D2ULL, 0xC6D346A0BF8B1341ULL, 0x01C2649CE5B548C7ULL, 0x433285774C5F7E54ULL,
-			0x5F77B9BE2BBA0B3BULL, 0x1D87585582103DA8ULL, 0xDA967A69D82E662EULL, 0x98669B8271C450BDULL,
-			0x16444E1291267141ULL, 0x54B4AFF938CC47D2ULL, 0x93A58DC562F21C56ULL, 0xD1556C2ECB181AC5ULL,
-			0xAB0B1451C30BA2FEULL, 0xE9FBF5BA6AE1946DULL, 0x2EEAD78630DFCFE9ULL, 0x6C1A366D9935F97AULL,
-			0xE238E3FD79F7D886ULL, 0xA0C80216D01DEE15ULL, 0x67D9202A8A23B591ULL, 0x2529C1C123C98302ULL,
-			0x396CFD08A42CF66DULL, 0x7B9C1CE30DC6C0FEULL, 0xBC8D3EDF57F89B7AULL, 0xFE7DDF34FE12ADE9ULL,
-			0x705F0AA41ED08C15ULL, 0x32AFEB4FB73ABA86ULL, 0xF5BEC973ED049102ULL, 0xB74E289844EE8791ULL,
-			0x9A20A0D1591A5F54ULL, 0xD8D0413AF0F069C7ULL, 0x1FC16306AACE3241ULL, 0x5D3182ED032404D2ULL,
-			0xD313577DE3E6252EULL, 0x91E3B6964A0C13BDULL, 0x56F294AA10324839ULL, 0x14027541B9D87EAAULL,
-			0x08474988DE3D0BC5ULL, 0x4AB7A86377D73D56ULL, 0x8DA68A5F2DE966D0ULL, 0xCF566BB484035043ULL,
-			0x4174BE2464C171BFULL, 0x03845FCFCD2B472CULL, 0xC4957DF397152CA8ULL, 0x86659C183EFF1A3BULL,
-			0xFC3BE42436EC8210ULL, 0xBECB05CF9F06B483ULL, 0x79DA27F3C538EF07ULL, 0x3B2AC6186CD2D994ULL,
-			0xB50813888C10F868ULL, 0xF7F8F26325FACEFBULL, 0x30E9D05F7FC4957DULL, 0x721931B4D62EA3EEULL,
-			0x6E5C0D7DB1CBD681ULL, 0x2CACEC961821E012ULL, 0xEBBDCEAA421FBB96ULL, 0xA94D2F41EBF58D05ULL,
-			0x276FFAD10B37ACF9ULL, 0x659F1B3AA2DD9A6AULL, 0xA28E3906F8E3C1EEULL, 0xE07ED8ED5109F77DULL,
-			0x57A3F6732BD745CFULL, 0x15531798823D735CULL, 0xD24235A4D80328D8ULL, 0x90B2D44F71E91E4BULL,
-			0x1E9001DF912B3FB7ULL, 0x5C60E03438C10924ULL, 0x9B71C20862FF52A0ULL, 0xD98123E3CB156433ULL,
-			0xC5C41F2AACF0115CULL, 0x8734FEC1051A27CFULL, 0x4025DCFD5F247C4BULL, 0x02D53D16F6CE4AD8ULL,
-			0x8CF7E886160C6B24ULL, 0xCE07096DBFE65DB7ULL, 0x09162B51E5D80631ULL, 0x4BE6CABA4C3230A2ULL,
-			0x31B8B286440CA899ULL, 0x7348536DED50E0AULL, 0xF0597151B77E25CEULL, 0xB2A990BA1E94135DULL,
-			0x3C8B452AFE5632A1ULL, 0x7E7BA4C157BC0432ULL, 0xB96A86FD0D825FB6ULL, 0xFB9A6716A4686925ULL,
-			0xE7DF5BDFC38D1C4AULL, 0xA52FBA346A672AD9ULL, 0x623E98083059715DULL, 0x20CE79E399B347CEULL,
-			0xAEECAC4279716632ULL, 0xEC1C4DA9D09B50A1ULL, 0x2B0D6F958AA50B25ULL, 0x69FD8E7E234F3DB6ULL,
-			0xF420A0E05991CF04ULL, 0xB6D0410BF07BF997ULL, 0x71C16337AA45A213ULL, 0x333182DC03AF9480ULL,
-			0xBD13574CE36DB57CULL, 0xFFE3B6A74A8783EFULL, 0x38F2949B10B9D86BULL, 0x7A027570B953EEF8ULL,
-			0x664769B9DEB69B97ULL, 0x24B78852775CAD04ULL, 0xE3A6AA6E2D62F680ULL, 0xA1564B858488C013ULL,
-			0x2F749E15644AE1EFULL, 0x6D847FFE0DA0D77CULL, 0xAA955DC2579E8CF8ULL, 0xE865BC29FE74BA6BULL,
-			0x923BC415F6672250ULL, 0xD0CB25FE5F8D14C3ULL, 0x17DA07C205B34F47ULL, 0x552AE629AC5939D4ULL,
-			0xDB0833B94C9B1828ULL, 0x99F8D252E5712EBBULL, 0x5EE9F06EBF4F753FULL, 0x1C19118516A543ACULL,
-			0x005C2D4C714036C3ULL, 0x42ACCCA7D8AA0050ULL, 0x85BDEE9822945BD4ULL, 0xC74D0F738B7E6D47ULL,
-			0x496FDAE36BBC4CBBULL, 0x0B9F3B08C2567A28ULL, 0xCC8E1934986821ACULL, 0x8E7EF8DF3182173FULL,
-			0x39A3D6414B5CA58DULL, 0x7B5337AAE2B6931EULL, 0xBC421596B888C89AULL, 0xFEB2F47D1162FE09ULL,
-			0x709021EDF1A0DFF5ULL, 0x3260C0065810E966ULL, 0xF571E23A022EB2E2ULL, 0xB78103D1ABC48471ULL,
-			0xABC43F18CC21F11EULL, 0xE934DEF365CBF78DULL, 0x2E25FCCF3FF5AC09ULL, 0x6CD51D24961F9A9AULL,
-			0xE2F7C8B476DD8866ULL, 0xA007295FDF37BEF5ULL, 0x67160B638509E571ULL, 0x25E6EA882CE3D3E2ULL,
-			0x5FB892B424F04BD9ULL, 0x1D48735F8D1A7D4AULL, 0xDA595163D72426CEULL, 0x98A9B0887ECE105DULL,
-			0x168B65189E0C31A1ULL, 0x547B84F337E60732ULL, 0x936AA6CF6DD85CB6ULL, 0xD19A4724C4326A25ULL,
-			0xCDDF7BEDAFD71F4AULL, 0x8F2F9A06063D29D9ULL, 0x483EB83A5C03725DULL, 0x0ACE59D1F5E944CEULL,
-			0x84EC8C41152B6532ULL, 0xC61C4DAAACC153A1ULL, 0x010D6F96F6FF0825ULL, 0x43FD8E7D5F153EB6ULL,
-			0xD420A0E325C9CC04ULL, 0x96D041088C23FA97ULL, 0x51C16334D61DA113ULL, 0x133182DF7FF79780ULL,
-			0x9D31574F9F35B67CULL, 0xDFC1B6A436DF80EFULL, 0x18D094986CE1DB6BULL, 0x5A207573C50BEDF8ULL,
-			0x466549BAACEE9897ULL, 0x0495A8510524AE04ULL, 0xC3848A6D5F1AF580ULL, 0x81746B86F6F0C313ULL,
-			0x0F56BE161632E2EFULL, 0x4DA65FFD5FD8D47CULL, 0x8AB77DC105E68FF8ULL, 0xC8479C2AAC0CB96BULL,
-			0xB219E416A41F21F0ULL, 0xF0E905FD0DF51763ULL, 0x37F827C157CB4CE7ULL, 0x7508C62AFE217A74ULL,
-			0xFB2A13BA1EE35B88ULL, 0xB9DAF251B7096D1BULL, 0x7ECBD06DED37369FULL, 0x3C3B318644DD000CULL,
-			0x207E0D4F23387563ULL, 0x628EECA48AD243F0ULL, 0xA59FCE98D0EC1874ULL, 0xE76F2F7379062EE7ULL,
-			0x694DFAE399C40F1BULL, 0x2BBD1B08302E3988ULL, 0xECAC39346A10620CULL, 0xAE5CD8DFC3FA549FULL,
-			0x1981F641B924E62DULL, 0x5B7117AA10CED0BEULL, 0x9C6035964AF08B3AULL, 0xDE90D47DE31ABDA9ULL,
-			0x50B201ED03D89C55ULL, 0x1242E006AA32AAC6ULL, 0xD553C23AF00CF142ULL, 0x97A323D159E6C7D1ULL,
-			0x8BE61F183E03B2BEULL, 0xC916FEF397E9842DULL, 0x0E07DCCFCDD7DFA9ULL, 0x4CF73D24643DE93AULL,
-			0xC2D5E8B484FF84C6ULL, 0x8025095F2D15B255ULL, 0x47342B63772BE9D1ULL, 0x05C4CA88DEC1DF42ULL,
-			0x7F9AB2B4D6D24779ULL, 0x3D6A535F7F3871EAULL, 0xFA7B716325063A6EULL, 0xB88B90888CEC0CFDULL,
-			0x36A945186C2E2D01ULL, 0x7459A4F3C5C41B92ULL, 0xB34886CF9FFA4016ULL, 0xF1B86724361076A5ULL,
-			0xEDFD5BED51F503CAULL, 0xAF0DBA06F81F3559ULL, 0x681C983AA2216EDDULL, 0x2AEC79D10BCB584EULL,
-			0xA4CEAC41EB0979B2ULL, 0xE63E4DAA42E34F21ULL, 0x212F6F9618DD14A5ULL, 0x63DF8E7DB1372236ULL};
+	static constexpr uint64_t kPolynomial{0x42F0E1EBA9EA3693ULL};
+
+public:
+	/// \brief Начальное значение контрольной суммы для update
+	static constexpr uint64_t kInitChecksum{0};
+
+	///
+	/// \brief Побитовый расчет одного байта - эталонное определение CRC, из него строятся таблицы
+	/// \param aChecksum текущая контрольная сумма
+	/// \param aValue байт данных
+	/// \return Рассчитанный CRC64
+	///
+	static constexpr uint64_t updateBitwise(uint64_t aChecksum, uint8_t aValue)
+	{
+		for (uint8_t bit = 0; bit < 8; ++bit) {
+			if ((aChecksum ^ aValue) & 0x01) {
+				aChecksum = (aChecksum >> 1) ^ kPolynomial;
+			} else {
+				aChecksum >>= 1;
+			}
+			aValue >>= 1;
+		}
+
+		return aChecksum;
+	}
+
+private:
+	/// \brief Отражение 64-битного слова, переводит полином между прямой и отраженной записью
+	static constexpr uint64_t reflect(uint64_t aValue)
+	{
+		uint64_t result = 0;
+
+		for (uint8_t bit = 0; bit < 64; ++bit) {
+			result = (result << 1) | ((aValue >> bit) & 0x01);
+		}
+
+		return result;
+	}
+
+	/// \brief Константа свертки: x^aDegree mod P в отраженной записи
+	static constexpr uint64_t foldConstant(size_t aDegree)
+	{
+		const uint64_t normal = reflect(kPolynomial);
+		uint64_t result = 1;
+
+		while (aDegree--) {
+			result = (result & 0x8000000000000000ULL) ? (result << 1) ^ normal : result << 1;
+		}
+
+		return reflect(result);
+	}
+
+	// Свертка блока 128 бит на Distance бит вперед: младшая половина умножается на x^(Distance+63), старшая
+	// на x^(Distance-1). Лишняя степень x компенсирует сдвиг на бит при умножении отраженных значений
+	template<size_t Distance>
+	static constexpr uint64_t kFoldLow{foldConstant(Distance + 63)};
+	template<size_t Distance>
+	static constexpr uint64_t kFoldHigh{foldConstant(Distance - 1)};
+
+	/// \brief Буферы короче этого считаются таблицами, свертка на них не окупается
+	static constexpr size_t kClmulThreshold{128};
+
+	/// \brief Произведение многочленов aFirst * aSecond mod P в отраженной записи
+	static constexpr uint64_t multiplyModP(uint64_t aFirst, uint64_t aSecond)
+	{
+		uint64_t result = 0;
+
+		for (uint64_t mask = 0x8000000000000000ULL; mask; mask >>= 1) {
+			if (aFirst & mask) {
+				result ^= aSecond;
+			}
+			aSecond = (aSecond & 0x01) ? (aSecond >> 1) ^ kPolynomial : aSecond >> 1;
+		}
+
+		return result;
+	}
+
+	/// \brief Степени x^(2^k) mod P, k = 0 ... 63, из них собирается сдвиг на произвольное число бит
+	static constexpr std::array<uint64_t, 64> makePowers()
+	{
+		std::array<uint64_t, 64> result{};
+		result[0] = 0x4000000000000000ULL; // x^1
+
+		for (size_t k = 1; k < result.size(); ++k) {
+			result[k] = multiplyModP(result[k - 1], result[k - 1]);
+		}
+
+		return result;
+	}
+
+	template<size_t = 0>
+	static constexpr std::array<uint64_t, 64> powers{makePowers()};
+
+	template<size_t Slices>
+	using Tables = std::array<std::array<uint64_t, 256>, Slices>;
+
+	/// \brief Таблицы для slice-by-N: tables[0] - обычная побайтовая таблица, tables[k] - вклад байта, за которым
+	/// следуют еще k нулевых байт
+	template<size_t Slices>
+	static constexpr Tables<Slices> makeTables()
+	{
+		Tables<Slices> result{};
+
+		for (size_t i = 0; i < 256; ++i) {
+			result[0][i] = updateBitwise(0, static_cast<uint8_t>(i));
+		}
+
+		for (size_t k = 1; k < Slices; ++k) {
+			for (size_t i = 0; i < 256; ++i) {
+				result[k][i] = (result[k - 1][i] >> 8) ^ result[0][result[k - 1][i] & 0xFF];
+			}
+		}
+
+		return result;
+	}
+
+	template<size_t Slices>
+	static constexpr Tables<Slices> tables{makeTables<Slices>()};
+
+	/// \brief Чтение 8 байт в порядке little-endian независимо от платформы
+	static uint64_t load(const uint8_t *aData)
+	{
+		uint64_t value;
+		memcpy(&value, aData, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		value = __builtin_bswap64(value);
+#endif
+		return value;
+	}
+
+	/// \brief Свертка 8 байт через таблицы tables[Offset + 7] ... tables[Offset]
+	template<size_t Slices, size_t Offset>
+	static uint64_t fold(uint64_t aValue)
+	{
+		const auto &t = tables<Slices>;
+		return t[Offset + 7][aValue & 0xFF] ^ t[Offset + 6][(aValue >> 8) & 0xFF] ^ t[Offset + 5][(aValue >> 16) & 0xFF]
+			^ t[Offset + 4][(aValue >> 24) & 0xFF] ^ t[Offset + 3][(aValue >> 32) & 0xFF]
+			^ t[Offset + 2][(aValue >> 40) & 0xFF] ^ t[Offset + 1][(aValue >> 48) & 0xFF] ^ t[Offset][aValue >> 56];
+	}
 
 public:
 	///
@@ -93,42 +187,267 @@ public:
 	///
 	static uint64_t calculate(const void *aData, size_t aLength)
 	{
-		uint64_t calculated = 0;
-		const uint8_t *data = static_cast<const uint8_t *>(aData);
+		return update(0, aData, aLength);
+	}
 
-		while (aLength--) { calculated = table[(calculated ^ *data++) & 0xFF] ^ (calculated >> 8); }
+	///
+	/// \brief Функция для расчета CRC64 для принимаемых сообщений, продолжает расчет с aChecksum
+	/// \param aChecksum текущая контрольная сумма
+	/// \param aBuffer указатель на буфер с данными
+	/// \param aLength размер буфера
+	/// \return Рассчитанный CRC64
+	///
+	static uint64_t update(uint64_t aChecksum, const void *aBuffer, size_t aLength)
+	{
+#if defined(UTILITARY_RS_CRC64_PCLMUL) || defined(UTILITARY_RS_CRC64_PMULL)
+		if (aLength >= kClmulThreshold) {
+			return kernel()(aChecksum, aBuffer, aLength);
+		}
+#endif
+		return updateSlice16(aChecksum, aBuffer, aLength);
+	}
 
-		return calculated;
+	///
+	/// \brief Объединяет контрольные суммы двух соседних блоков: combine(calculate(A), calculate(B), len(B))
+	/// равно calculate(A || B). Сумма первого блока сдвигается на длину второго возведением x в степень в GF(2),
+	/// за O(log aSecondLength) умножений
+	/// \param aFirst CRC64 первого блока
+	/// \param aSecond CRC64 второго блока
+	/// \param aSecondLength длина второго блока в байтах
+	/// \return CRC64 объединенного блока
+	///
+	static constexpr uint64_t combine(uint64_t aFirst, uint64_t aSecond, uint64_t aSecondLength)
+	{
+		// x^(8 * aSecondLength) mod P, начиная с x^0
+		uint64_t shift = 0x8000000000000000ULL;
+
+		for (size_t k = 3; aSecondLength; aSecondLength >>= 1, ++k) {
+			if (aSecondLength & 0x01) {
+				shift = multiplyModP(powers<>[k & 63], shift);
+			}
+		}
+
+		return multiplyModP(shift, aFirst) ^ aSecond;
 	}
 
 	///
-	/// \brief Функция для расчета CRC64 для принимаемых сообщений
+	/// \brief Расчет slice-by-8: 8 байт за шаг, таблицы 16 КБ
 	/// \param aChecksum текущая контрольная сумма
 	/// \param aBuffer указатель на буфер с данными
 	/// \param aLength размер буфера
 	/// \return Рассчитанный CRC64
 	///
-	static uint64_t update(uint64_t aChecksum, const void *aBuffer, size_t aLength)
+	static uint64_t updateSlice8(uint64_t aChecksum, const void *aBuffer, size_t aLength)
 	{
 		const uint8_t *buffer = static_cast<const uint8_t *>(aBuffer);
-		constexpr uint64_t polynomial = 0x42F0E1EBA9EA3693ULL;
-
-		while (aLength--) {
-			uint8_t value = *buffer++;
-			for (uint8_t bit = 0; bit < 8; ++bit) {
-				if ((aChecksum ^ value) & 0x01) {
-					aChecksum = (aChecksum >> 1) ^ polynomial;
-				} else {
-					aChecksum >>= 1;
-				}
-				value >>= 1;
-			}
+
+		for (; aLength >= 8; aLength -= 8, buffer += 8) {
+			aChecksum = fold<8, 0>(aChecksum ^ load(buffer));
+		}
+
+		return updateBytes(aChecksum, buffer, aLength);
+	}
+
+	///
+	/// \brief Расчет slice-by-16: 16 байт за шаг, таблицы 32 КБ
+	/// \param aChecksum текущая контрольная сумма
+	/// \param aBuffer указатель на буфер с данными
+	/// \param aLength размер буфера
+	/// \return Рассчитанный CRC64
+	///
+	static uint64_t updateSlice16(uint64_t aChecksum, const void *aBuffer, size_t aLength)
+	{
+		const uint8_t *buffer = static_cast<const uint8_t *>(aBuffer);
+
+		for (; aLength >= 16; aLength -= 16, buffer += 16) {
+			aChecksum = fold<16, 8>(aChecksum ^ load(buffer)) ^ fold<16, 0>(load(buffer + 8));
 		}
 
+		return updateBytes(aChecksum, buffer, aLength);
+	}
+
+	///
+	/// \brief Побайтовый табличный расчет, для хвостов и коротких буферов
+	/// \param aChecksum текущая контрольная сумма
+	/// \param aBuffer указатель на буфер с данными
+	/// \param aLength размер буфера
+	/// \return Рассчитанный CRC64
+	///
+	static uint64_t updateBytes(uint64_t aChecksum, const void *aBuffer, size_t aLength)
+	{
+		const uint8_t *buffer = static_cast<const uint8_t *>(aBuffer);
+		const auto &table = tables<1>[0];
+
+		while (aLength--) { aChecksum = table[(aChecksum ^ *buffer++) & 0xFF] ^ (aChecksum >> 8); }
+
 		return aChecksum;
 	}
-};
+private:
+	using Kernel = uint64_t (*)(uint64_t, const void *, size_t);
+
+#if defined(UTILITARY_RS_CRC64_PCLMUL)
+	__attribute__((target("pclmul"))) static __m128i foldBlock(__m128i aValue, __m128i aConstants, const uint8_t *aData)
+	{
+		const __m128i low = _mm_clmulepi64_si128(aValue, aConstants, 0x00);
+		const __m128i high = _mm_clmulepi64_si128(aValue, aConstants, 0x11);
+		const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(aData));
+		return _mm_xor_si128(_mm_xor_si128(low, high), data);
+	}
+
+	/// \brief Свертка через PCLMULQDQ: четыре независимых блока по 128 бит, затем сведение в один
+	__attribute__((target("pclmul"))) static uint64_t updateFolded(uint64_t aChecksum, const void *aBuffer,
+		size_t aLength)
+	{
+		const uint8_t *buffer = static_cast<const uint8_t *>(aBuffer);
+
+		if (aLength < 64) {
+			return updateSlice16(aChecksum, buffer, aLength);
+		}
+
+		const __m128i fold512 = _mm_set_epi64x(static_cast<long long>(kFoldHigh<512>), static_cast<long long>(kFoldLow<512>));
+		const __m128i fold128 = _mm_set_epi64x(static_cast<long long>(kFoldHigh<128>), static_cast<long long>(kFoldLow<128>));
+
+		// Начальное значение CRC эквивалентно XOR с первыми 8 байтами данных
+		__m128i x0 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer)),
+			_mm_cvtsi64_si128(static_cast<long long>(aChecksum)));
+		__m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + 16));
+		__m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + 32));
+		__m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer + 48));
+
+		for (buffer += 64, aLength -= 64; aLength >= 64; buffer += 64, aLength -= 64) {
+			x0 = foldBlock(x0, fold512, buffer);
+			x1 = foldBlock(x1, fold512, buffer + 16);
+			x2 = foldBlock(x2, fold512, buffer + 32);
+			x3 = foldBlock(x3, fold512, buffer + 48);
+		}
+
+		uint8_t folded[64];
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(folded), x1);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(folded + 16), x2);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(folded + 32), x3);
+
+		x0 = foldBlock(x0, fold128, folded);
+		x0 = foldBlock(x0, fold128, folded + 16);
+		x0 = foldBlock(x0, fold128, folded + 32);
+
+		for (; aLength >= 16; buffer += 16, aLength -= 16) {
+			x0 = foldBlock(x0, fold128, buffer);
+		}
+
+		// Оставшийся блок сравним с исходными данными по модулю P, его CRC от нуля и есть текущая сумма
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(folded), x0);
+		return updateSlice16(updateSlice16(0, folded, 16), buffer, aLength);
+	}
+
+	static bool hasCarrylessMultiply()
+	{
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("pclmul");
+	}
+#elif defined(UTILITARY_RS_CRC64_PMULL)
+#if defined(__clang__)
+#define UTILITARY_RS_CRC64_PMULL_TARGET __attribute__((target("aes")))
+#else
+#define UTILITARY_RS_CRC64_PMULL_TARGET __attribute__((target("+crypto")))
+#endif
+
+	UTILITARY_RS_CRC64_PMULL_TARGET static uint64x2_t foldBlock(uint64x2_t aValue, uint64_t aLow, uint64_t aHigh,
+		const uint8_t *aData)
+	{
+		const uint64x2_t low = vreinterpretq_u64_p128(
+			vmull_p64(static_cast<poly64_t>(vgetq_lane_u64(aValue, 0)), static_cast<poly64_t>(aLow)));
+		const uint64x2_t high = vreinterpretq_u64_p128(
+			vmull_p64(static_cast<poly64_t>(vgetq_lane_u64(aValue, 1)), static_cast<poly64_t>(aHigh)));
+		return veorq_u64(veorq_u64(low, high), vreinterpretq_u64_u8(vld1q_u8(aData)));
+	}
+
+	/// \brief Свертка через PMULL: четыре независимых блока по 128 бит, затем сведение в один
+	UTILITARY_RS_CRC64_PMULL_TARGET static uint64_t updateFolded(uint64_t aChecksum, const void *aBuffer, size_t aLength)
+	{
+		const uint8_t *buffer = static_cast<const uint8_t *>(aBuffer);
+
+		if (aLength < 64) {
+			return updateSlice16(aChecksum, buffer, aLength);
+		}
+
+		// Начальное значение CRC эквивалентно XOR с первыми 8 байтами данных
+		uint64x2_t x0 = veorq_u64(vreinterpretq_u64_u8(vld1q_u8(buffer)), vcombine_u64(vcreate_u64(aChecksum), vcreate_u64(0)));
+		uint64x2_t x1 = vreinterpretq_u64_u8(vld1q_u8(buffer + 16));
+		uint64x2_t x2 = vreinterpretq_u64_u8(vld1q_u8(buffer + 32));
+		uint64x2_t x3 = vreinterpretq_u64_u8(vld1q_u8(buffer + 48));
+
+		for (buffer += 64, aLength -= 64; aLength >= 64; buffer += 64, aLength -= 64) {
+			x0 = foldBlock(x0, kFoldLow<512>, kFoldHigh<512>, buffer);
+			x1 = foldBlock(x1, kFoldLow<512>, kFoldHigh<512>, buffer + 16);
+			x2 = foldBlock(x2, kFoldLow<512>, kFoldHigh<512>, buffer + 32);
+			x3 = foldBlock(x3, kFoldLow<512>, kFoldHigh<512>, buffer + 48);
+		}
+
+		uint8_t folded[64];
+		vst1q_u8(folded, vreinterpretq_u8_u64(x1));
+		vst1q_u8(folded + 16, vreinterpretq_u8_u64(x2));
+		vst1q_u8(folded + 32, vreinterpretq_u8_u64(x3));
+
+		x0 = foldBlock(x0, kFoldLow<128>, kFoldHigh<128>, folded);
+		x0 = foldBlock(x0, kFoldLow<128>, kFoldHigh<128>, folded + 16);
+		x0 = foldBlock(x0, kFoldLow<128>, kFoldHigh<128>, folded + 32);
+
+		for (; aLength >= 16; buffer += 16, aLength -= 16) {
+			x0 = foldBlock(x0, kFoldLow<128>, kFoldHigh<128>, buffer);
+		}
+
+		// Оставшийся блок сравним с исходными данными по модулю P, его CRC от нуля и есть текущая сумма
+		vst1q_u8(folded, vreinterpretq_u8_u64(x0));
+		return updateSlice16(updateSlice16(0, folded, 16), buffer, aLength);
+	}
+
+#undef UTILITARY_RS_CRC64_PMULL_TARGET
+
+	static bool hasCarrylessMultiply()
+	{
+		return getauxval(AT_HWCAP) & HWCAP_PMULL;
+	}
+#else
+	static uint64_t updateFolded(uint64_t aChecksum, const void *aBuffer, size_t aLength)
+	{
+		return updateSlice16(aChecksum, aBuffer, aLength);
+	}
 
-constexpr uint64_t Crc64::table[];
+	static bool hasCarrylessMultiply()
+	{
+		return false;
+	}
+#endif
+
+	/// \brief Ядро для длинных буферов, выбирается один раз при первом вызове
+	static Kernel kernel()
+	{
+		static const Kernel selected = hasCarrylessMultiply() ? &updateFolded : &updateSlice16;
+		return selected;
+	}
+
+public:
+	///
+	/// \brief Доступна ли на этом процессоре свертка через умножение без переносов
+	/// \return true, если update использует PCLMULQDQ или PMULL
+	///
+	static bool hasClmul()
+	{
+		return kernel() != &updateSlice16;
+	}
+
+	///
+	/// \brief Расчет сверткой через умножение без переносов, без проверки возможностей процессора.
+	/// Вызывать только при hasClmul() == true
+	/// \param aChecksum текущая контрольная сумма
+	/// \param aBuffer указатель на буфер с данными
+	/// \param aLength размер буфера
+	/// \return Рассчитанный CRC64
+	///
+	static uint64_t updateClmul(uint64_t aChecksum, const void *aBuffer, size_t aLength)
+	{
+		return updateFolded(aChecksum, aBuffer, aLength);
+	}
+};
 
 #endif // LIB_CRC64_HPP_
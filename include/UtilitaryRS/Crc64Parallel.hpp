@@ -0,0 +1,184 @@
+/*!
+\file
+\brief Многопоточный расчет Crc64 для больших образов
+\author V-Nezlo (vlladimirka@gmail.com)
+\date 16.10.2026
+\version 1.0
+
+Буфер делится на равные части, каждая считается в своем потоке, частичные суммы объединяются через
+Crc64::combine. Результат совпадает с Crc64::calculate, то есть с тем, что устройство получает в
+handleWriteChunkFinalize.
+Части считаются на постоянном пуле потоков, который создается при первом многопоточном расчете и живет до
+завершения программы, - запуск потоков на каждый вызов стоил бы дороже самого расчета. Буфер короче двух
+частей по kMinSegment считается в вызывающем потоке без обращения к пулу
+*/
+
+#ifndef LIB_CRC64PARALLEL_HPP_
+#define LIB_CRC64PARALLEL_HPP_
+
+#include "Crc64.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class Crc64Parallel {
+	Crc64Parallel() = delete;
+	Crc64Parallel(const Crc64Parallel &) = delete;
+	Crc64Parallel &operator=(const Crc64Parallel &) = delete;
+
+	/// \brief Постоянные рабочие потоки, задачи берутся из общей очереди
+	class Pool {
+	public:
+		explicit Pool(size_t aWorkers) :
+			stopping{false}
+		{
+			workers.reserve(aWorkers);
+
+			for (size_t i = 0; i < aWorkers; ++i) {
+				workers.emplace_back([this]() { run(); });
+			}
+		}
+
+		~Pool()
+		{
+			{
+				const std::lock_guard<std::mutex> lock{mutex};
+				stopping = true;
+			}
+
+			ready.notify_all();
+
+			for (auto &worker : workers) { worker.join(); }
+		}
+
+		void submit(std::function<void()> aTask)
+		{
+			{
+				const std::lock_guard<std::mutex> lock{mutex};
+				tasks.push(std::move(aTask));
+			}
+
+			ready.notify_one();
+		}
+
+	private:
+		std::vector<std::thread> workers;
+		std::queue<std::function<void()>> tasks;
+		std::mutex mutex;
+		std::condition_variable ready;
+		bool stopping;
+
+		void run()
+		{
+			while (true) {
+				std::function<void()> task;
+
+				{
+					std::unique_lock<std::mutex> lock{mutex};
+					ready.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+					if (tasks.empty()) {
+						return;
+					}
+
+					task = std::move(tasks.front());
+					tasks.pop();
+				}
+
+				task();
+			}
+		}
+	};
+
+	/// \brief Ожидание завершения частей одного вызова
+	class Completion {
+	public:
+		explicit Completion(size_t aCount) : left{aCount} {}
+
+		void done()
+		{
+			// Уведомление под блокировкой: после последней части ожидающий поток сразу уничтожает объект
+			const std::lock_guard<std::mutex> lock{mutex};
+			--left;
+			finished.notify_one();
+		}
+
+		void wait()
+		{
+			std::unique_lock<std::mutex> lock{mutex};
+			finished.wait(lock, [this]() { return left == 0; });
+		}
+
+	private:
+		size_t left;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+
+	/// \return Пул на все ядра, кроме вызывающего потока, но не меньше одного потока
+	static Pool &pool()
+	{
+		static Pool instance{std::max<size_t>(2, std::thread::hardware_concurrency()) - 1};
+		return instance;
+	}
+
+public:
+	/// \brief Части меньше этого размера не выносятся в отдельный поток, передача части в пул дороже расчета
+	static constexpr size_t kMinSegment{1024 * 1024};
+
+	///
+	/// \brief Рассчитывает CRC64 для буфера на нескольких потоках
+	/// \param aData указатель на буфер с данными
+	/// \param aLength длина буфера с данными
+	/// \param aThreads число частей (потоков вместе с вызывающим), 0 - по числу ядер. Если частей больше, чем
+	/// потоков в пуле, лишние части ждут в очереди
+	/// \param aMinSegment минимальный размер части на один поток
+	/// \return Рассчитанный CRC64, равный Crc64::calculate(aData, aLength)
+	///
+	static uint64_t calculate(const void *aData, size_t aLength, size_t aThreads = 0, size_t aMinSegment = kMinSegment)
+	{
+		if (!aThreads) {
+			aThreads = std::max<size_t>(1, std::thread::hardware_concurrency());
+		}
+
+		const size_t segments = std::min(aThreads, std::max<size_t>(1, aLength / std::max<size_t>(1, aMinSegment)));
+
+		if (segments <= 1) {
+			return Crc64::calculate(aData, aLength);
+		}
+
+		const uint8_t *data = static_cast<const uint8_t *>(aData);
+		const size_t segment = aLength / segments;
+		std::vector<uint64_t> partial(segments);
+		Completion completion{segments - 1};
+
+		// Последняя часть забирает остаток от деления
+		for (size_t i = 1; i < segments; ++i) {
+			const size_t length = i + 1 == segments ? aLength - i * segment : segment;
+			pool().submit([&partial, &completion, data, segment, length, i]() {
+				partial[i] = Crc64::calculate(data + i * segment, length);
+				completion.done();
+			});
+		}
+
+		partial[0] = Crc64::calculate(data, segment);
+		completion.wait();
+
+		uint64_t result = partial[0];
+
+		for (size_t i = 1; i < segments; ++i) {
+			const size_t length = i + 1 == segments ? aLength - i * segment : segment;
+			result = Crc64::combine(result, partial[i], length);
+		}
+
+		return result;
+	}
+};
+
+#endif // LIB_CRC64PARALLEL_HPP_
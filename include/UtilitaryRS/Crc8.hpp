@@ -83,21 +83,22 @@ public:
 		const uint8_t *buffer = static_cast<const uint8_t *>(aBuffer);
 
 		while (aLength--) {
-			uint8_t value = *buffer++;
-
-			for (uint8_t bit = 0; bit < 8; ++bit) {
-				if ((aChecksum ^ value) & 0x01) {
-					aChecksum = static_cast<uint8_t>(((aChecksum ^ 0x18) >> 1) | 0x80);
-				} else {
-					aChecksum = static_cast<uint8_t>(aChecksum >> 1);
-				}
-
-				value = static_cast<uint8_t>(value >> 1);
-			}
+			aChecksum = update(aChecksum, *buffer++);
 		}
 
 		return aChecksum;
 	}
+
+	///
+	/// \brief Потоковый расчет CRC8 - добавляет к контрольной сумме один байт
+	/// \param aChecksum текущая контрольная сумма
+	/// \param aValue очередной байт
+	/// \return Рассчитанный CRC8
+	///
+	static constexpr uint8_t update(uint8_t aChecksum, uint8_t aValue)
+	{
+		return table[aChecksum ^ aValue];
+	}
 };
 
 constexpr uint8_t Crc8::table[];
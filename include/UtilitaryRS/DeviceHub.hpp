@@ -11,17 +11,58 @@
 
 #include "RsHandler.hpp"
 #include "RsTypes.hpp"
+#include <array>
 #include <chrono>
 #include <map>
+#include <memory>
 #include <optional>
 #include <queue>
 #include <string>
+#include <string_view>
 #include <thread>
 
 namespace RS {
 
-/// \brief Интерфейс наблюдателя за DeviceHub
-class DeviceHubObserver {
+/// \brief Дескриптор устройства хаба, см. DeviceHub::findDevice
+struct DeviceHandle {
+	uint8_t uid{kReservedUID};
+	uint32_t generation{0}; // Номер регистрации слота, после перерегистрации устройства дескриптор недействителен
+
+	bool valid() const
+	{
+		return uid != kReservedUID;
+	}
+};
+
+/// \brief Устройство, к которому относится событие хаба. Имя - ссылка на дескриптор хаба, валидна только
+/// на время вызова
+struct DeviceEvent {
+	DeviceHandle handle;
+	const std::string &name;
+};
+
+/// \brief Интерфейс наблюдателя за DeviceHub с событиями по дескриптору устройства: без строк и аллокаций на
+/// каждое событие. Вместо виртуального интерфейса в параметре Observer хаба можно указать любой класс с теми же
+/// функциями - тогда вызовы не виртуальные и встраиваются
+class DeviceHubEventObserver {
+public:
+	virtual void onAckNotReceived(const DeviceEvent &aDevice, MessageType aMessage) = 0;
+	virtual void onAckReceived(const DeviceEvent &aDevice, MessageType aMessage, Result aCode) = 0;
+
+	virtual void onCommandResult(const DeviceEvent &aDevice, Result aReturn) = 0;
+	virtual void onRequestError(const DeviceEvent &aDevice, Result aReturn) = 0;
+
+	virtual Result onBlobAnswer(const DeviceEvent &aDevice, uint8_t aRequest, const void *aData, size_t aSize) = 0;
+
+	virtual void onDeviceRegistered(const DeviceEvent &aDevice, DeviceVersion aVersion) = 0;
+	virtual void onDeviceLost(const DeviceEvent &aDevice) = 0;
+
+	virtual Result onFileWriteResult(const DeviceEvent &aDevice, Result aReturn) = 0;
+	virtual void onDeviceHealth(const DeviceEvent &aDevice, Health aHealth, uint16_t aFlags) = 0;
+};
+
+/// \brief Интерфейс наблюдателя за DeviceHub с событиями по имени устройства
+class DeviceHubObserver : public DeviceHubEventObserver {
 public:
 	virtual void onAckNotReceivedEv(const std::string &aName, MessageType aMessage) = 0;
 	virtual void onAckReceivedEv(const std::string &aName, MessageType aMessage, Result aCode) = 0;
@@ -36,19 +77,92 @@ public:
 
 	virtual Result fileWriteResultEv(const std::string &aName, Result aReturn) = 0;
 	virtual void deviceHealthReceivedEv(const std::string &aName, Health aHealth, uint16_t aFlags) = 0;
+
+private:
+	void onAckNotReceived(const DeviceEvent &aDevice, MessageType aMessage) final
+	{
+		onAckNotReceivedEv(aDevice.name, aMessage);
+	}
+
+	void onAckReceived(const DeviceEvent &aDevice, MessageType aMessage, Result aCode) final
+	{
+		onAckReceivedEv(aDevice.name, aMessage, aCode);
+	}
+
+	void onCommandResult(const DeviceEvent &aDevice, Result aReturn) final
+	{
+		onCommandResultEv(aDevice.name, aReturn);
+	}
+
+	void onRequestError(const DeviceEvent &aDevice, Result aReturn) final
+	{
+		onRequestErrorEv(aDevice.name, aReturn);
+	}
+
+	Result onBlobAnswer(const DeviceEvent &aDevice, uint8_t aRequest, const void *aData, size_t aSize) final
+	{
+		return blobAnswerEvReceived(aDevice.name, aRequest, aData, aSize);
+	}
+
+	void onDeviceRegistered(const DeviceEvent &aDevice, DeviceVersion aVersion) final
+	{
+		deviceRegisteredEv(aDevice.name, aVersion);
+	}
+
+	void onDeviceLost(const DeviceEvent &aDevice) final
+	{
+		deviceLostEv(aDevice.name);
+	}
+
+	Result onFileWriteResult(const DeviceEvent &aDevice, Result aReturn) final
+	{
+		return fileWriteResultEv(aDevice.name, aReturn);
+	}
+
+	void onDeviceHealth(const DeviceEvent &aDevice, Health aHealth, uint16_t aFlags) final
+	{
+		deviceHealthReceivedEv(aDevice.name, aHealth, aFlags);
+	}
 };
 
-template<uint8_t MaxDeviceCount, class Interface, typename Time, typename Crc8, typename CrcFile, size_t ParserSize>
+/// \brief Хаб устройств
+/// \tparam CrcFile CRC файлов в FileWriteFinalize: Crc64, Crc64Legacy для устройств со старой прошивкой или класс
+/// с kInitChecksum и update(checksum, data, length)
+/// \tparam Observer наблюдатель: DeviceHubEventObserver (и DeviceHubObserver через него) или класс с теми же
+/// функциями без виртуальных вызовов
+template<uint8_t MaxDeviceCount, class Interface, typename Time, typename Crc8, typename CrcFile, size_t ParserSize,
+	typename Observer = DeviceHubEventObserver>
 class DeviceHub : public RsHandler<Interface, Crc8, ParserSize> {
 	using Base = RsHandler<Interface, Crc8, ParserSize>;
 
 	static constexpr size_t kTimeoutErrorForLost{20};
 	static constexpr auto kHealthTimeout{std::chrono::milliseconds{1000}};
+	static constexpr auto kAnswerTimeout{std::chrono::milliseconds{200}};
+	// Ожидание окончательного ответа после Ack(Wait) на команду или запрос
+	static constexpr auto kDeferredTimeout{std::chrono::milliseconds{2000}};
+	static constexpr size_t kOccupancyWords{(MaxDeviceCount + 63) / 64};
+
+public:
+	static constexpr auto kNoDeadline{std::chrono::milliseconds::max()};
+
+private:
+	/// \brief Срок обработки устройства в очереди сроков
+	struct Deadline {
+		std::chrono::milliseconds time;
+		uint8_t uid;
+		uint32_t generation;
+
+		bool operator>(const Deadline &aOther) const
+		{
+			return time > aOther.time || (time == aOther.time && uid > aOther.uid);
+		}
+	};
 
 	struct PendingTrans {
 		uint8_t messageNumber; // Номер сообщения, который был отправлен
 		MessageType msgType; // Тип сообщения которое отправили
 		std::chrono::milliseconds timestamp; // время отправления
+		std::chrono::milliseconds timeout; // время ожидания ответа
 	};
 
 	enum class DeviceState : uint8_t { Probing, InfoRequest, Running, FileTransfer, Suspended, Lost };
@@ -67,21 +181,22 @@ class DeviceHub : public RsHandler<Interface, Crc8, ParserSize> {
 		size_t sentOffset{0};
 		size_t chunkSent{0};
 		size_t chunkSize{0};
+		uint64_t crc{0}; // Контрольная сумма подтвержденных чанков
 		std::optional<Result> packetAck;
 		bool firstPacket{true};
 
 		enum class State { Request, Sending, Finalize, Cancel } state;
 	};
 
-	struct DeviceWrapper {
+	/// \brief Данные устройства, которые нужны только при работе с ним. Создаются при занятии слота, пустые слоты
+	/// их не держат
+	struct DeviceData {
 		std::string name;
 		DeviceVersion version;
-		DeviceState state{DeviceState::InfoRequest};
-		std::optional<PendingTrans> pending;
 
-		std::chrono::milliseconds nextCall{std::chrono::milliseconds{0}};
 		std::chrono::milliseconds lastAck{std::chrono::milliseconds{0}};
 		std::chrono::milliseconds lastHealthReq{std::chrono::milliseconds{0}};
+		std::chrono::milliseconds nextSend{std::chrono::milliseconds{0}}; // Раньше не отправлять, см. setSendInterval
 
 		std::queue<std::pair<uint8_t, uint8_t>> commandQueue;
 		std::queue<std::pair<std::uint8_t, uint8_t>> requestQueue;
@@ -91,12 +206,25 @@ class DeviceHub : public RsHandler<Interface, Crc8, ParserSize> {
 
 		FileTransferContext fileTransContext;
 
-		DeviceWrapper()
+		DeviceData()
 		{
 			name.reserve(16);
 		}
 	};
 
+	/// \brief Слот устройства: то, что просматривает очередь сроков, лежит компактно в массиве слотов
+	struct DeviceWrapper {
+		uint8_t uid{kReservedUID};
+		DeviceState state{DeviceState::InfoRequest};
+		uint32_t generation{0};
+		std::optional<PendingTrans> pending;
+
+		std::chrono::milliseconds nextCall{std::chrono::milliseconds{0}};
+		std::chrono::milliseconds scheduled{kNoDeadline}; // Срок действующей записи в очереди сроков
+
+		std::unique_ptr<DeviceData> data; // Есть у всех занятых слотов
+	};
+
 public:
 
 	/// \brief Конструктор хаба
@@ -107,14 +235,17 @@ public:
 	DeviceHub(const DeviceVersion &aHubVersion, Interface &aIface, std::string aName = "Master", uint8_t aUID = 0) :
 		Base(aName.c_str(), aHubVersion, aUID, aIface),
 		hub{},
+		occupied{},
 		observer{nullptr},
 		nameToUid{},
-		temporaryUid{std::nullopt}
+		generations{0},
+		sendInterval{0},
+		deadlines{}
 	{ }
 
 	/// \brief Зарегистрировать наблюдателя
 	/// \param aObserver
-	void registerObserver(DeviceHubObserver *aObserver)
+	void registerObserver(Observer *aObserver)
 	{
 		observer = aObserver;
 	}
@@ -126,87 +257,154 @@ public:
 	{
 		if (!aBlocking) {
 			for (uint8_t uid = 1; uid < MaxDeviceCount; ++uid) { Base::sendProbe(aBroadcast ? kReservedUID : uid); }
+			Base::flush();
 		} else {
 			for (uint8_t uid = 1; uid < MaxDeviceCount; ++uid) {
 				Base::sendProbe(aBroadcast ? kReservedUID : uid);
+				Base::flush();
 				std::this_thread::sleep_for(std::chrono::milliseconds{100});
 			}
 		}
 
 	}
 
-	/// \brief Базовая функция, вызывать в планировщике
+	/// \brief Базовая функция, вызывать в планировщике. Обрабатываются только устройства, срок которых наступил
 	/// \param aTime текущее время
-	void process(std::chrono::milliseconds aTime)
+	/// \return время, к которому нужно вызвать process() снова, или kNoDeadline, если ждать нечего. Ответы
+	/// устройств, принятые через update(), могут сделать срок ближе - после update() стоит вызвать process()
+	std::chrono::milliseconds process(std::chrono::milliseconds aTime)
 	{
-		for (auto &pos : hub) {
-			// Базовая обработка
-			DeviceWrapper &dev = pos.second;
-			processDevice(dev, aTime);
+		while (!deadlines.empty() && deadlines.top().time <= aTime) {
+			const Deadline due = deadlines.top();
+			deadlines.pop();
 
-			// Проверим таймауты
-			if (dev.pending.has_value() && aTime - dev.pending.value().timestamp >= std::chrono::milliseconds{200}) {
-				++dev.timeoutCounter;
+			DeviceWrapper *dev = getDevice(DeviceHandle{due.uid, due.generation});
 
-				if (dev.timeoutCounter >= kTimeoutErrorForLost) {
-					dev.timeoutCounter = 0;
-					dev.state = DeviceState::Lost;
-				}
+			// Запись устарела: устройство перерегистрировано или его срок уже перенесен
+			if (dev == nullptr || dev->scheduled != due.time) {
+				continue;
+			}
 
-				if (observer) {
-					observer->onAckNotReceivedEv(dev.name, dev.pending.value().msgType);
-				}
+			dev->scheduled = kNoDeadline;
+			processSlot(*dev, aTime);
+			schedule(*dev, std::max(nextDeadline(*dev), aTime + std::chrono::milliseconds{1}));
+		}
 
-				// Сбросим процедуру отправки файла если зафакапились
-				if (dev.state == DeviceState::FileTransfer) {
-					dev.fileTransContext.state = FileTransferContext::State::Cancel;
-				}
+		// Все сообщения такта уходят одной пачкой, если интерфейс буферизующий
+		Base::flush();
+		return nextDeadline();
+	}
 
-				dev.pending.reset();
-			}
+	/// \brief Ограничить частоту транзакций: следующая транзакция устройства уходит не раньше чем через aInterval
+	/// после предыдущей. По умолчанию не ограничено - следующая транзакция уходит сразу по ответу на текущую
+	/// \param aInterval минимальный интервал между транзакциями одного устройства
+	void setSendInterval(std::chrono::milliseconds aInterval)
+	{
+		sendInterval = aInterval;
+	}
+
+	/// \brief Найти устройство по имени. Дескриптор достаточно получить один раз: вызовы с ним обходятся без
+	/// поиска по строке, а после перерегистрации устройства дескриптор становится недействительным
+	/// \param aDeviceName имя устройства
+	/// \return дескриптор, невалидный если устройство не зарегистрировано
+	DeviceHandle findDevice(std::string_view aDeviceName) const
+	{
+		auto it = nameToUid.find(aDeviceName);
+		if (it == nameToUid.end()) {
+			return DeviceHandle{};
+		}
+
+		return DeviceHandle{it->second, hub[it->second].generation};
+	}
+
+	/// \brief Имя устройства по дескриптору
+	/// \param aDevice дескриптор устройства
+	/// \return имя или пустая строка, если дескриптор недействителен
+	std::string_view deviceName(DeviceHandle aDevice) const
+	{
+		if (!isOccupied(aDevice.uid) || hub[aDevice.uid].generation != aDevice.generation) {
+			return {};
 		}
+
+		return hub[aDevice.uid].data->name;
 	}
 
 	/// \brief Отправить команду на устройство - обработка через очередь
-	/// \param aDeviceName имя устройства
+	/// \param aDevice дескриптор устройства
 	/// \param aCommand команда
 	/// \param aValue аргумент
 	/// \return true если успех
-	bool sendCmdToDevice(const std::string &aDeviceName, uint8_t aCommand, uint8_t aValue)
+	bool sendCmdToDevice(DeviceHandle aDevice, uint8_t aCommand, uint8_t aValue)
 	{
-		uint8_t devUid = getUIDFromName(aDeviceName);
-		if (devUid == kReservedUID) {
+		DeviceWrapper *dev = getDevice(aDevice);
+
+		if (dev == nullptr || dev->state != DeviceState::Running) {
 			return false;
 		}
 
-		DeviceWrapper &dev = hub[devUid];
+		dev->data->commandQueue.push(std::make_pair(aCommand, aValue));
+		kick(*dev);
+		Base::flush();
+		return true;
+	}
+
+	/// \brief Отправить команду на устройство - обработка через очередь
+	/// \param aDeviceName имя устройства
+	/// \param aCommand команда
+	/// \param aValue аргумент
+	/// \return true если успех
+	bool sendCmdToDevice(std::string_view aDeviceName, uint8_t aCommand, uint8_t aValue)
+	{
+		return sendCmdToDevice(findDevice(aDeviceName), aCommand, aValue);
+	}
+
+	/// \brief Отправить разовый реквест на устройство, очередь
+	/// \param aDevice дескриптор устройства
+	/// \param aBlobRequest номер запроса
+	/// \param aBlobSize ожидаемый размер ответа
+	/// \return true если успех
+	bool sendBlobRequestToDevice(DeviceHandle aDevice, uint8_t aBlobRequest, uint8_t aBlobSize)
+	{
+		DeviceWrapper *dev = getDevice(aDevice);
 
-		if (dev.state != DeviceState::Running) {
+		if (dev == nullptr || dev->state != DeviceState::Running) {
 			return false;
 		}
 
-		dev.commandQueue.push(std::make_pair(aCommand, aValue));
+		dev->data->requestQueue.push(std::make_pair(aBlobRequest, aBlobSize));
+		kick(*dev);
+		Base::flush();
 		return true;
 	}
 
 	/// \brief Отправить разовый реквест на устройство, очередь
 	/// \param aDeviceName имя устройства
 	/// \param aBlobRequest номер запроса
+	/// \param aBlobSize ожидаемый размер ответа
 	/// \return true если успех
-	bool sendBlobRequestToDevice(const std::string &aDeviceName, uint8_t aBlobRequest, uint8_t aBlobSize)
+	bool sendBlobRequestToDevice(std::string_view aDeviceName, uint8_t aBlobRequest, uint8_t aBlobSize)
 	{
-		uint8_t devUid = getUIDFromName(aDeviceName);
-		if (devUid == kReservedUID) {
-			return false;
-		}
+		return sendBlobRequestToDevice(findDevice(aDeviceName), aBlobRequest, aBlobSize);
+	}
 
-		DeviceWrapper &dev = hub[devUid];
+	/// \brief Создать запрос по расписанию для устройства
+	/// \param aDevice дескриптор устройства
+	/// \param aReq запрос
+	/// \param aReqSize длина запроса
+	/// \param aTimeout период опроса
+	/// \return true если успех
+	bool createSchedRequest(DeviceHandle aDevice, uint8_t aReq, uint8_t aReqSize, std::chrono::milliseconds aTimeout)
+	{
+		DeviceWrapper *dev = getDevice(aDevice);
 
-		if (dev.state != DeviceState::Running) {
+		if (dev == nullptr) {
 			return false;
 		}
 
-		dev.requestQueue.push(std::make_pair(aBlobRequest, aBlobSize));
+		TelemetryUnit entry{aReq, aReqSize, aTimeout, std::chrono::milliseconds{0}};
+		dev->data->telemSched.push_back(entry);
+		kick(*dev);
+		Base::flush();
 		return true;
 	}
 
@@ -217,56 +415,65 @@ public:
 	/// \param aTimeout период опроса
 	/// \return true если успех
 	bool createSchedRequest(
-		const std::string &aDeviceName, uint8_t aReq, uint8_t aReqSize, std::chrono::milliseconds aTimeout)
+		std::string_view aDeviceName, uint8_t aReq, uint8_t aReqSize, std::chrono::milliseconds aTimeout)
 	{
-		uint8_t devUid = getUIDFromName(aDeviceName);
-		if (devUid == kReservedUID) {
-			return false;
-		}
-
-		DeviceWrapper &dev = hub[devUid];
-
-		TelemetryUnit entry{aReq, aReqSize, aTimeout, std::chrono::milliseconds{0}};
-		dev.telemSched.push_back(entry);
-		return true;
+		return createSchedRequest(findDevice(aDeviceName), aReq, aReqSize, aTimeout);
 	}
 
 	/// \brief Отправить файл
-	/// \param aDeviceName имя устройства
+	/// \param aDevice дескриптор устройства
 	/// \param aFile номер файла
 	/// \param aData данные
 	/// \param aSize длина данных
 	/// \param aChunkSize размер чанка
 	/// \return true если команда принята
-	bool sendFile(const std::string &aDeviceName, uint8_t aFile, const void *aData, size_t aSize, size_t aChunkSize)
+	bool sendFile(DeviceHandle aDevice, uint8_t aFile, const void *aData, size_t aSize, size_t aChunkSize)
 	{
-		uint8_t devUid = getUIDFromName(aDeviceName);
-		if (devUid == kReservedUID) {
-			return false;
-		}
+		DeviceWrapper *dev = getDevice(aDevice);
 
-		DeviceWrapper &dev = hub[devUid];
-		if (dev.state != DeviceState::Running) {
+		if (dev == nullptr || dev->state != DeviceState::Running) {
 			return false;
 		}
 
-		dev.state = DeviceState::FileTransfer;
-		dev.fileTransContext.state = FileTransferContext::State::Request;
-		dev.fileTransContext.chunkSize = aChunkSize;
-		dev.fileTransContext.data = aData;
-		dev.fileTransContext.totalSize = aSize;
-		dev.fileTransContext.sentOffset = 0;
-		dev.fileTransContext.file = aFile;
-		dev.fileTransContext.firstPacket = true;
-
+		dev->state = DeviceState::FileTransfer;
+		dev->data->fileTransContext.state = FileTransferContext::State::Request;
+		dev->data->fileTransContext.chunkSize = aChunkSize;
+		dev->data->fileTransContext.data = aData;
+		dev->data->fileTransContext.totalSize = aSize;
+		dev->data->fileTransContext.sentOffset = 0;
+		dev->data->fileTransContext.crc = CrcFile::kInitChecksum;
+		dev->data->fileTransContext.file = aFile;
+		dev->data->fileTransContext.firstPacket = true;
+
+		// Запрос на запись уходит в ближайшем process(), а не к сроку health или телеметрии
+		dev->nextCall = Time::milliseconds();
+		dev->scheduled = kNoDeadline;
+		schedule(*dev, nextDeadline(*dev));
+		Base::flush();
 		return true;
 	}
 
+	/// \brief Отправить файл
+	/// \param aDeviceName имя устройства
+	/// \param aFile номер файла
+	/// \param aData данные
+	/// \param aSize длина данных
+	/// \param aChunkSize размер чанка
+	/// \return true если команда принята
+	bool sendFile(std::string_view aDeviceName, uint8_t aFile, const void *aData, size_t aSize, size_t aChunkSize)
+	{
+		return sendFile(findDevice(aDeviceName), aFile, aData, aSize, aChunkSize);
+	}
+
 private:
-	std::map<uint8_t, DeviceWrapper> hub;
-	DeviceHubObserver *observer;
-	std::map<std::string, uint8_t> nameToUid;
-	std::optional<uint8_t> temporaryUid;
+	std::array<DeviceWrapper, MaxDeviceCount> hub; // Слот устройства - его UID, данные устройства создаются в addDevice
+	std::array<uint64_t, kOccupancyWords> occupied; // Битовая карта занятых слотов
+	Observer *observer;
+	std::map<std::string, uint8_t, std::less<>> nameToUid;
+	uint32_t generations; // Счетчик регистраций слотов, см. DeviceHandle
+	std::chrono::milliseconds sendInterval; // Минимальный интервал между транзакциями устройства
+	// Очередь сроков устройств: ближайший сверху, устаревшие записи пропускаются при извлечении
+	std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> deadlines;
 
 	// RsHandler interface
 	void handleDeviceInfoAnswer(uint8_t aTranceiverUID, uint8_t aMessageNumber, DeviceVersion aVersion,
@@ -281,15 +488,29 @@ private:
 
 		if (dev->pending && dev->pending.value().messageNumber == aMessageNumber && dev->state == DeviceState::InfoRequest) {
 			dev->pending.reset();
+
+			// Устройство могло зарегистрироваться в этом слоте под другим именем
+			auto previous = nameToUid.find(dev->data->name);
+			if (previous != nameToUid.end() && previous->second == aTranceiverUID) {
+				nameToUid.erase(previous);
+			}
+
+			// Новая регистрация слота: прежние дескрипторы и записи в очереди сроков недействительны, даже если
+			// устройство вернулось под тем же именем
+			dev->generation = ++generations;
+			dev->scheduled = kNoDeadline;
+
 			// Заполним дескриптор
-			dev->name.clear();
-			dev->name.assign(static_cast<const char *>(aName), aNameLen);
-			dev->version = aVersion;
+			dev->data->name.clear();
+			dev->data->name.assign(static_cast<const char *>(aName), aNameLen);
+			dev->data->version = aVersion;
 			dev->state = DeviceState::Running;
-			nameToUid[dev->name] = aTranceiverUID;
+			nameToUid[dev->data->name] = aTranceiverUID;
 
 			if (observer)
-				observer->deviceRegisteredEv(dev->name, dev->version);
+				observer->onDeviceRegistered(event(*dev), dev->data->version);
+
+			kick(*dev);
 		}
 	}
 
@@ -299,17 +520,30 @@ private:
 
 		// Если устройства нет - создаем его и выходим
 		if (dev == nullptr) {
-			hub[aTranceiverUID] = DeviceWrapper{};
-			temporaryUid = aTranceiverUID;
+			if (aTranceiverUID < MaxDeviceCount) {
+				addDevice(aTranceiverUID);
+			}
 			return;
 		}
 
 		// Иначе разбираемся что это за ответ
-		dev->lastAck = Time::milliseconds();
+		dev->data->lastAck = Time::milliseconds();
 		// Если мы ожидаем ответа и получаем ответ с правильным номером сообщения
 		if (dev->pending && dev->pending.value().messageNumber == aMessageNumber) {
+			// Устройство отложило ответ на команду или запрос - ждем окончательный ответ с тем же номером дольше
+			if (aReturnCode == Result::Wait && dev->state == DeviceState::Running
+				&& (dev->pending.value().msgType == MessageType::Command
+					|| dev->pending.value().msgType == MessageType::BlobRequest)) {
+				dev->pending.value().timestamp = dev->data->lastAck;
+				dev->pending.value().timeout = kDeferredTimeout;
+				// Срок переносится позже, прежняя запись на обычный таймаут станет устаревшей
+				dev->scheduled = kNoDeadline;
+				schedule(*dev, nextDeadline(*dev));
+				return;
+			}
+
 			if (observer) {
-				observer->onAckReceivedEv(dev->name, dev->pending.value().msgType, aReturnCode);
+				observer->onAckReceived(event(*dev), dev->pending.value().msgType, aReturnCode);
 			}
 
 			switch (dev->state) {
@@ -323,7 +557,7 @@ private:
 					switch (dev->pending.value().msgType) {
 						case MessageType::Command:
 							if (observer)
-								observer->onCommandResultEv(dev->name, aReturnCode);
+								observer->onCommandResult(event(*dev), aReturnCode);
 							break;
 
 						case MessageType::Reboot:
@@ -331,7 +565,7 @@ private:
 							break;
 						case MessageType::BlobRequest:
 							if (observer)
-								observer->onRequestErrorEv(dev->name, aReturnCode);
+								observer->onRequestError(event(*dev), aReturnCode);
 							break;
 
 						default:
@@ -343,20 +577,20 @@ private:
 				case DeviceState::FileTransfer: {
 					switch (dev->pending.value().msgType) {
 						case MessageType::FileWriteChunk:
-							dev->fileTransContext.packetAck = aReturnCode;
+							dev->data->fileTransContext.packetAck = aReturnCode;
 
 							break;
 						case MessageType::FileWriteRequest:
 							if (aReturnCode == Result::Ok) {
-								dev->fileTransContext.state = FileTransferContext::State::Sending;
+								dev->data->fileTransContext.state = FileTransferContext::State::Sending;
 							} else {
-								dev->fileTransContext.state = FileTransferContext::State::Cancel;
+								dev->data->fileTransContext.state = FileTransferContext::State::Cancel;
 							}
 							break;
 						case MessageType::FileWriteFinalize:
 							dev->state = DeviceState::Running;
 							if (observer)
-								observer->fileWriteResultEv(dev->name, aReturnCode);
+								observer->onFileWriteResult(event(*dev), aReturnCode);
 							break;
 						// Недопустимо или слейв сам иницирует взаимодействие
 						default:
@@ -369,6 +603,7 @@ private:
 			}
 
 			dev->pending.reset();
+			kick(*dev);
 		}
 	}
 
@@ -387,9 +622,9 @@ private:
 			&& dev->pending.value().msgType == MessageType::BlobRequest) {
 
 			dev->pending.reset();
-			if (observer)  {
-				return observer->blobAnswerEvReceived(dev->name, aRequest, aData, aLength);
-			}
+			const Result result = observer ? observer->onBlobAnswer(event(*dev), aRequest, aData, aLength) : Result::Error;
+			kick(*dev);
+			return result;
 		}
 
 		return Result::Error;
@@ -407,95 +642,118 @@ private:
 		if (dev->pending.has_value() && dev->pending.value().messageNumber == aMessageNumber
 			&& dev->pending.value().msgType == MessageType::HealthReq) {
 			if (observer)
-				observer->deviceHealthReceivedEv(dev->name, aHealth, aFlags);
+				observer->onDeviceHealth(event(*dev), aHealth, aFlags);
 			dev->pending.reset();
+			kick(*dev);
 		}
 	}
 
-	void cmdToDeviceImpl(const std::string &aDeviceName, uint8_t aCommand, uint8_t aValue)
+	/// \brief Отправить следующую транзакцию рабочего режима
+	/// \param aDevice устройство без ожидающей транзакции
+	/// \param aTime текущее время
+	/// \return true, если транзакция отправлена
+	bool dispatch(DeviceWrapper &aDevice, std::chrono::milliseconds aTime)
 	{
-		uint8_t devUid = getUIDFromName(aDeviceName);
-
-		if (devUid == kReservedUID) {
-			return;
+		// Сначала посмотрим в очередь команд
+		if (!aDevice.data->commandQueue.empty()) {
+			const auto val = aDevice.data->commandQueue.front();
+			aDevice.data->commandQueue.pop();
+			cmdToDeviceImpl(aDevice, val.first, val.second);
+			return true;
 		}
 
-		DeviceWrapper &dev = hub[devUid];
-		updateDevicePending(dev, Base::sendCommand(devUid, aCommand, aValue), MessageType::Command);
-	}
+		// Потом в очередь запросов (ручных)
+		if (!aDevice.data->requestQueue.empty()) {
+			const auto request = aDevice.data->requestQueue.front();
+			aDevice.data->requestQueue.pop();
+			deviceRequestImpl(aDevice, request.first, request.second);
+			return true;
+		}
 
-	void deviceRequestImpl(const std::string &aDeviceName, uint8_t aRequest, uint8_t aRequestSize)
-	{
-		uint8_t devUid = getUIDFromName(aDeviceName);
+		// Потом посмотрим, не пора ли спросить флаги и health
+		if (aTime - aDevice.data->lastHealthReq >= kHealthTimeout) {
+			aDevice.data->lastHealthReq = aTime;
+			deviceHealthReqImpl(aDevice);
+			return true;
+		}
 
-		if (devUid == kReservedUID) {
-			return;
+		// Потом в очередь расписаний телеметрии, за раз уходит один опрос, остальные - по следующим ответам
+		for (auto &telem : aDevice.data->telemSched) {
+			if (aTime - telem.lastUpdateTime >= telem.updateTime) {
+				telem.lastUpdateTime = aTime;
+				deviceRequestImpl(aDevice, telem.req, telem.reqSize);
+				return true;
+			}
 		}
 
-		DeviceWrapper &dev = hub[devUid];
-		updateDevicePending(dev, Base::sendBlobRequest(devUid, aRequest, aRequestSize), MessageType::BlobRequest);
+		return false;
 	}
 
-	void deviceFileWriteRequestImpl(const std::string &aDeviceName, uint8_t aFile, size_t aSize)
+	/// \return Время ближайшего health или опроса телеметрии
+	static std::chrono::milliseconds idleDeadline(const DeviceWrapper &aDevice)
 	{
-		uint8_t devUid = getUIDFromName(aDeviceName);
+		std::chrono::milliseconds deadline = aDevice.data->lastHealthReq + kHealthTimeout;
 
-		if (devUid == kReservedUID) {
-			return;
+		for (const auto &telem : aDevice.data->telemSched) {
+			deadline = std::min(deadline, telem.lastUpdateTime + telem.updateTime);
 		}
 
-		DeviceWrapper &dev = hub[devUid];
-		updateDevicePending(dev, Base::fileWriteRequest(devUid, aFile, aSize), MessageType::FileWriteRequest);
+		return deadline;
 	}
 
-	void sendChunkImpl(const std::string &aDeviceName, uint8_t aFileNum, const void *aChunk, uint8_t aChunkSize)
+	/// \brief Транзакция устройства завершилась или для него появилась работа: в рабочем режиме следующая
+	/// транзакция отправляется сразу, если это позволяет ограничение частоты, иначе - к его сроку
+	/// \param aDevice устройство
+	void kick(DeviceWrapper &aDevice)
 	{
-		uint8_t devUid = getUIDFromName(aDeviceName);
-
-		if (devUid == kReservedUID) {
+		if (aDevice.state != DeviceState::Running || aDevice.pending.has_value()) {
 			return;
 		}
 
-		DeviceWrapper &dev = hub[devUid];
+		const auto now = Time::milliseconds();
+		aDevice.nextCall = aDevice.data->nextSend;
 
-		if (aFileNum != dev.fileTransContext.file) {
-			return;
+		if (now >= aDevice.nextCall) {
+			processDevice(aDevice, now);
 		}
 
-		updateDevicePending(dev, Base::fileWriteChunk(devUid, dev.fileTransContext.file, aChunk, aChunkSize), MessageType::FileWriteChunk);
+		// Срок мог стоять на таймауте завершенной транзакции: ставим точный, прежняя запись станет устаревшей
+		aDevice.scheduled = kNoDeadline;
+		schedule(aDevice, nextDeadline(aDevice));
 	}
 
-	void fileWriteFinalizeImpl(const std::string &aDeviceName, uint8_t aFileNum, uint16_t aChunkNumber, uint64_t aCrc)
+	void cmdToDeviceImpl(DeviceWrapper &aDevice, uint8_t aCommand, uint8_t aValue)
 	{
-		uint8_t devUid = getUIDFromName(aDeviceName);
-
-		if (devUid == kReservedUID) {
-			return;
-		}
+		updateDevicePending(aDevice, Base::sendCommand(aDevice.uid, aCommand, aValue), MessageType::Command);
+	}
 
-		DeviceWrapper &dev = hub[devUid];
-		updateDevicePending(dev, Base::fileWriteFinalize(devUid, aFileNum, aChunkNumber, aCrc), MessageType::FileWriteFinalize);
+	void deviceRequestImpl(DeviceWrapper &aDevice, uint8_t aRequest, uint8_t aRequestSize)
+	{
+		updateDevicePending(aDevice, Base::sendBlobRequest(aDevice.uid, aRequest, aRequestSize), MessageType::BlobRequest);
 	}
 
-	void deviceHealthReqImpl(const std::string &aDeviceName)
+	void deviceFileWriteRequestImpl(DeviceWrapper &aDevice, uint8_t aFile, size_t aSize)
 	{
-		uint8_t devUid = getUIDFromName(aDeviceName);
+		updateDevicePending(aDevice, Base::fileWriteRequest(aDevice.uid, aFile, aSize), MessageType::FileWriteRequest);
+	}
 
-		if (devUid == kReservedUID) {
+	void sendChunkImpl(DeviceWrapper &aDevice, uint8_t aFileNum, const void *aChunk, uint8_t aChunkSize)
+	{
+		if (aFileNum != aDevice.data->fileTransContext.file) {
 			return;
 		}
 
-		DeviceWrapper &dev = hub[devUid];
-		updateDevicePending(dev, Base::sendHealthRequest(devUid), MessageType::HealthReq);
+		updateDevicePending(aDevice, Base::fileWriteChunk(aDevice.uid, aDevice.data->fileTransContext.file, aChunk, aChunkSize), MessageType::FileWriteChunk);
 	}
 
-	uint8_t getUIDFromName(const std::string &aName)
+	void fileWriteFinalizeImpl(DeviceWrapper &aDevice, uint8_t aFileNum, uint16_t aChunkNumber, uint64_t aCrc)
 	{
-		auto it = nameToUid.find(aName);
-		if (it == nameToUid.end()) {
-			return kReservedUID; // если имя не найдено
-		}
-		return it->second;
+		updateDevicePending(aDevice, Base::fileWriteFinalize(aDevice.uid, aFileNum, aChunkNumber, aCrc), MessageType::FileWriteFinalize);
+	}
+
+	void deviceHealthReqImpl(DeviceWrapper &aDevice)
+	{
+		updateDevicePending(aDevice, Base::sendHealthRequest(aDevice.uid), MessageType::HealthReq);
 	}
 
 	void processDevice(DeviceWrapper &aDevice, std::chrono::milliseconds aTime)
@@ -506,129 +764,107 @@ private:
 
 			switch (aDevice.state) {
 				case DeviceState::Probing: {
-					updateDevicePending(aDevice, Base::sendProbe(getUIDFromName(aDevice.name)), MessageType::Probe);
+					updateDevicePending(aDevice, Base::sendProbe(aDevice.uid), MessageType::Probe);
 					updateTime = std::chrono::milliseconds{1000};
 				} break;
 				case DeviceState::InfoRequest: {
-					if (temporaryUid) {
-						updateDevicePending(aDevice, Base::sendDeviceInfoRequest(temporaryUid.value()), MessageType::DeviceInfoReq);
-						temporaryUid.reset();
-					} else {
-						updateDevicePending(aDevice, Base::sendDeviceInfoRequest(getUIDFromName(aDevice.name)), MessageType::DeviceInfoReq);
-					}
+					updateDevicePending(aDevice, Base::sendDeviceInfoRequest(aDevice.uid), MessageType::DeviceInfoReq);
 					updateTime = std::chrono::milliseconds{1000};
 				} break;
 				case DeviceState::Running: {
-					// Сначала посмотрим в очередь команд
-					if (!aDevice.commandQueue.empty()) {
-						const auto val = aDevice.commandQueue.front();
-						aDevice.commandQueue.pop();
-						cmdToDeviceImpl(aDevice.name, val.first, val.second);
-						// Потом в очередь запросов (ручных)
-					} else if (!aDevice.requestQueue.empty()) {
-						const auto request = aDevice.requestQueue.front();
-						aDevice.requestQueue.pop();
-						deviceRequestImpl(aDevice.name, request.first, request.second);
-						// Потом посмотрим, не пора ли спросить флаги и health
-					} else if (aTime - aDevice.lastHealthReq >= kHealthTimeout) {
-						aDevice.lastHealthReq = aTime;
-						deviceHealthReqImpl(aDevice.name);
-						// Потом в очередь расписаний телеметрии
-					} else if (!aDevice.telemSched.empty()) {
-						TelemetryUnit *telem = nullptr;
-						for (auto &pos : aDevice.telemSched) {
-							if (aTime - pos.lastUpdateTime >= pos.updateTime) {
-								pos.lastUpdateTime = aTime;
-								telem = &pos;
-							}
-						}
-						if (telem != nullptr) {
-							deviceRequestImpl(aDevice.name, telem->req, telem->reqSize);
-						}
+					// Пока транзакция не завершена, следующая не отправляется: ее запустит ответ (kick) или таймаут
+					if (aDevice.pending.has_value()) {
+						updateTime = std::chrono::milliseconds{0};
+					} else if (dispatch(aDevice, aTime)) {
+						// Без ограничения частоты следующая транзакция уйдет сразу по ответу на эту
+						aDevice.data->nextSend = aTime + sendInterval;
+						updateTime = sendInterval;
 					} else {
-						// Делать нечего
+						// Делать нечего - до ближайшего health или опроса телеметрии
+						updateTime = idleDeadline(aDevice) - aTime;
 					}
 				} break;
 				case DeviceState::FileTransfer: {
-					switch (aDevice.fileTransContext.state) {
+					switch (aDevice.data->fileTransContext.state) {
 						case FileTransferContext::State::Request: {
 							deviceFileWriteRequestImpl(
-								aDevice.name, aDevice.fileTransContext.file, aDevice.fileTransContext.totalSize);
+								aDevice, aDevice.data->fileTransContext.file, aDevice.data->fileTransContext.totalSize);
 							// Раньше будет или ответ или ошибка таймаута
 							updateTime = std::chrono::milliseconds{50};
 						} break;
 
 						case FileTransferContext::State::Sending: {
 							// Первый чанк шлем без проверок
-							if (aDevice.fileTransContext.firstPacket) {
-								const size_t chunk = std::min(aDevice.fileTransContext.chunkSize,
-									aDevice.fileTransContext.totalSize - aDevice.fileTransContext.sentOffset);
-								const uint8_t *ptr = static_cast<const uint8_t *>(aDevice.fileTransContext.data)
-									+ aDevice.fileTransContext.sentOffset;
-								sendChunkImpl(aDevice.name, aDevice.fileTransContext.file, ptr, chunk);
-								aDevice.fileTransContext.firstPacket = false;
+							if (aDevice.data->fileTransContext.firstPacket) {
+								const size_t chunk = std::min(aDevice.data->fileTransContext.chunkSize,
+									aDevice.data->fileTransContext.totalSize - aDevice.data->fileTransContext.sentOffset);
+								const uint8_t *ptr = static_cast<const uint8_t *>(aDevice.data->fileTransContext.data)
+									+ aDevice.data->fileTransContext.sentOffset;
+								sendChunkImpl(aDevice, aDevice.data->fileTransContext.file, ptr, chunk);
+								aDevice.data->fileTransContext.firstPacket = false;
 							} else {
 								// Теперь можно уже оформлять event-based с переповторами
 								// Вышел таймаут - сброс отправки, чето сломалось
-								if (!aDevice.fileTransContext.packetAck) {
-									aDevice.fileTransContext.state = FileTransferContext::State::Cancel;
+								if (!aDevice.data->fileTransContext.packetAck) {
+									aDevice.data->fileTransContext.state = FileTransferContext::State::Cancel;
 								} else {
-									const uint8_t lastChunk = static_cast<uint8_t>(std::min(aDevice.fileTransContext.chunkSize,
-										aDevice.fileTransContext.totalSize - aDevice.fileTransContext.sentOffset));
+									const uint8_t lastChunk = static_cast<uint8_t>(std::min(aDevice.data->fileTransContext.chunkSize,
+										aDevice.data->fileTransContext.totalSize - aDevice.data->fileTransContext.sentOffset));
 
 									// Ответ пришел,смотрим что там устройство сообщило
-									if (aDevice.fileTransContext.packetAck.value() == Result::Busy) {
+									if (aDevice.data->fileTransContext.packetAck.value() == Result::Busy) {
 										// Было занято, переотправим последний пакет
-										const uint8_t *ptr = static_cast<const uint8_t *>(aDevice.fileTransContext.data)
-											+ aDevice.fileTransContext.sentOffset;
-										sendChunkImpl(aDevice.name, aDevice.fileTransContext.file, ptr, lastChunk);
-									} else if (aDevice.fileTransContext.packetAck.value() == Result::Wait) {
+										const uint8_t *ptr = static_cast<const uint8_t *>(aDevice.data->fileTransContext.data)
+											+ aDevice.data->fileTransContext.sentOffset;
+										sendChunkImpl(aDevice, aDevice.data->fileTransContext.file, ptr, lastChunk);
+									} else if (aDevice.data->fileTransContext.packetAck.value() == Result::Wait) {
 										// Подождем немножко
 										updateTime = std::chrono::milliseconds{200};
-									} else if (aDevice.fileTransContext.packetAck.value() == Result::Ok) {
-										// Пометим чанк как отправленный
-										aDevice.fileTransContext.sentOffset += lastChunk;
-										++aDevice.fileTransContext.chunkSent;
+									} else if (aDevice.data->fileTransContext.packetAck.value() == Result::Ok) {
+										// Пометим чанк как отправленный и добавим его в контрольную сумму файла
+										const uint8_t *acked = static_cast<const uint8_t *>(aDevice.data->fileTransContext.data)
+											+ aDevice.data->fileTransContext.sentOffset;
+										aDevice.data->fileTransContext.crc = CrcFile::update(aDevice.data->fileTransContext.crc, acked, lastChunk);
+										aDevice.data->fileTransContext.sentOffset += lastChunk;
+										++aDevice.data->fileTransContext.chunkSent;
 
 										// если отправили все чанки - выходим
-										if (aDevice.fileTransContext.sentOffset == aDevice.fileTransContext.totalSize) {
+										if (aDevice.data->fileTransContext.sentOffset == aDevice.data->fileTransContext.totalSize) {
 											// Отправили всё, теперь пора финализировать
-											aDevice.fileTransContext.state = FileTransferContext::State::Finalize;
-											aDevice.fileTransContext.packetAck.reset();
+											aDevice.data->fileTransContext.state = FileTransferContext::State::Finalize;
+											aDevice.data->fileTransContext.packetAck.reset();
 											updateTime = std::chrono::milliseconds{500};
 										} else {
-											const uint8_t nextChunk = static_cast<uint8_t>(std::min(aDevice.fileTransContext.chunkSize,
-												aDevice.fileTransContext.totalSize - aDevice.fileTransContext.sentOffset));
+											const uint8_t nextChunk = static_cast<uint8_t>(std::min(aDevice.data->fileTransContext.chunkSize,
+												aDevice.data->fileTransContext.totalSize - aDevice.data->fileTransContext.sentOffset));
 
-											const uint8_t *ptr = static_cast<const uint8_t *>(aDevice.fileTransContext.data)
-												+ aDevice.fileTransContext.sentOffset;
-											sendChunkImpl(aDevice.name, aDevice.fileTransContext.file, ptr, nextChunk);
+											const uint8_t *ptr = static_cast<const uint8_t *>(aDevice.data->fileTransContext.data)
+												+ aDevice.data->fileTransContext.sentOffset;
+											sendChunkImpl(aDevice, aDevice.data->fileTransContext.file, ptr, nextChunk);
 										}
 									} else {
 										// Во всех других случаях пишем ошибку
-										aDevice.fileTransContext.state = FileTransferContext::State::Cancel;
+										aDevice.data->fileTransContext.state = FileTransferContext::State::Cancel;
 									}
 
-									aDevice.fileTransContext.packetAck.reset();
+									aDevice.data->fileTransContext.packetAck.reset();
 								}
 							}
 						} break;
 
 						case FileTransferContext::State::Finalize: {
-							// Посчитаем CRC64 от нашего буффера
-							const auto crc
-								= CrcFile::calculate(aDevice.fileTransContext.data, aDevice.fileTransContext.totalSize);
-							fileWriteFinalizeImpl(
-								aDevice.name, aDevice.fileTransContext.file, static_cast<uint16_t>(aDevice.fileTransContext.chunkSent), crc);
+							// CRC64 файла уже накоплен по мере подтверждения чанков, повтор финализации его не пересчитывает
+							fileWriteFinalizeImpl(aDevice, aDevice.data->fileTransContext.file,
+								static_cast<uint16_t>(aDevice.data->fileTransContext.chunkSent), aDevice.data->fileTransContext.crc);
 							updateTime = std::chrono::milliseconds{500};
 						} break;
 
 						case FileTransferContext::State::Cancel: {
 							// Сбросим режим если вернулась ошибка
-							aDevice.fileTransContext = FileTransferContext{};
+							aDevice.data->fileTransContext = FileTransferContext{};
 							aDevice.state = DeviceState::Running;
-							Result result = aDevice.fileTransContext.packetAck ? aDevice.fileTransContext.packetAck.value() : Result::Error;
-							if (observer) observer->fileWriteResultEv(aDevice.name, result);
+							Result result = aDevice.data->fileTransContext.packetAck ? aDevice.data->fileTransContext.packetAck.value() : Result::Error;
+							if (observer) observer->onFileWriteResult(event(aDevice), result);
 						} break;
 					}
 				} break;
@@ -636,7 +872,7 @@ private:
 				case DeviceState::Suspended:
 					break;
 				case DeviceState::Lost:
-					if (observer) observer->deviceLostEv(aDevice.name);
+					if (observer) observer->onDeviceLost(event(aDevice));
 					aDevice.state = DeviceState::Probing;
 					break;
 			}
@@ -645,12 +881,107 @@ private:
 		}
 	}
 
+	/// \brief Проверка таймаута ожидающей транзакции и основная обработка устройства
+	/// \param aDevice устройство
+	/// \param aTime текущее время
+	void processSlot(DeviceWrapper &aDevice, std::chrono::milliseconds aTime)
+	{
+		// Сначала таймаут: освободившееся устройство сразу получает следующую транзакцию
+		if (aDevice.pending.has_value() && aTime - aDevice.pending.value().timestamp >= aDevice.pending.value().timeout) {
+			++aDevice.data->timeoutCounter;
+
+			if (aDevice.data->timeoutCounter >= kTimeoutErrorForLost) {
+				aDevice.data->timeoutCounter = 0;
+				aDevice.state = DeviceState::Lost;
+			}
+
+			if (observer) {
+				observer->onAckNotReceived(event(aDevice), aDevice.pending.value().msgType);
+			}
+
+			// Сбросим процедуру отправки файла если зафакапились
+			if (aDevice.state == DeviceState::FileTransfer) {
+				aDevice.data->fileTransContext.state = FileTransferContext::State::Cancel;
+			}
+
+			aDevice.pending.reset();
+		}
+
+		processDevice(aDevice, aTime);
+	}
+
+	/// \brief Занять слот под новое устройство, прежнее содержимое слота сбрасывается
+	/// \param aUid UID устройства, меньше MaxDeviceCount
+	void addDevice(uint8_t aUid)
+	{
+		DeviceWrapper &dev = hub[aUid];
+		dev = DeviceWrapper{};
+		dev.uid = aUid;
+		dev.generation = ++generations;
+		dev.data = std::make_unique<DeviceData>();
+		occupied[aUid / 64] |= uint64_t{1} << (aUid % 64);
+		schedule(dev, dev.nextCall);
+	}
+
+	/// \return Ближайший срок устройства: следующее действие или таймаут ожидающей транзакции
+	static std::chrono::milliseconds nextDeadline(const DeviceWrapper &aDevice)
+	{
+		if (aDevice.pending.has_value()) {
+			const auto timeout = aDevice.pending.value().timestamp + aDevice.pending.value().timeout;
+			// В рабочем режиме устройство ждет ответа или таймаута, остальные режимы идут по своему расписанию
+			return aDevice.state == DeviceState::Running ? timeout : std::min(aDevice.nextCall, timeout);
+		}
+
+		return aDevice.nextCall;
+	}
+
+	/// \return Ближайший срок по всем устройствам, устаревшие записи сверху очереди выбрасываются
+	std::chrono::milliseconds nextDeadline()
+	{
+		while (!deadlines.empty()) {
+			const Deadline &top = deadlines.top();
+			const DeviceWrapper *dev = getDevice(DeviceHandle{top.uid, top.generation});
+
+			if (dev != nullptr && dev->scheduled == top.time) {
+				return top.time;
+			}
+
+			deadlines.pop();
+		}
+
+		return kNoDeadline;
+	}
+
+	/// \brief Поставить срок обработки устройства, если он раньше уже стоящего
+	/// \param aDevice устройство
+	/// \param aTime срок
+	void schedule(DeviceWrapper &aDevice, std::chrono::milliseconds aTime)
+	{
+		if (aTime < aDevice.scheduled) {
+			aDevice.scheduled = aTime;
+			deadlines.push(Deadline{aTime, aDevice.uid, aDevice.generation});
+		}
+	}
+
+	bool isOccupied(uint8_t aUid) const
+	{
+		return aUid < MaxDeviceCount && (occupied[aUid / 64] & (uint64_t{1} << (aUid % 64))) != 0;
+	}
+
 	DeviceWrapper *getDevice(uint8_t uid)
 	{
-		auto it = hub.find(uid);
-		if (it == hub.end())
-			return nullptr;
-		return &it->second;
+		return isOccupied(uid) ? &hub[uid] : nullptr;
+	}
+
+	static DeviceEvent event(const DeviceWrapper &aDevice)
+	{
+		return DeviceEvent{DeviceHandle{aDevice.uid, aDevice.generation}, aDevice.data->name};
+	}
+
+	DeviceWrapper *getDevice(DeviceHandle aHandle)
+	{
+		DeviceWrapper *dev = getDevice(aHandle.uid);
+		return dev != nullptr && dev->generation == aHandle.generation ? dev : nullptr;
 	}
 
 	static void updateDevicePending(DeviceWrapper &aDevice, uint8_t aMessageNumber, MessageType aMessageType)
@@ -659,6 +990,7 @@ private:
 		pending.messageNumber = aMessageNumber;
 		pending.msgType = aMessageType;
 		pending.timestamp = Time::milliseconds();
+		pending.timeout = kAnswerTimeout;
 		aDevice.pending.emplace(pending);
 	}
 };
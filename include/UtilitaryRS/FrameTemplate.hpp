@@ -0,0 +1,114 @@
+/*!
+\file
+\brief Заранее собранное сообщение постоянного вида, в котором меняются только получатель и номер
+\author V-Nezlo (vlladimirka@gmail.com)
+\date 16.10.2026
+\version 1.0
+
+Probe, HealthReq и DeviceInfoReq отличаются друг от друга только receiverUID и number. Сообщение собирается
+один раз, при отправке в нем подменяются эти два байта, а CRC правится по линейности: вклад каждого байта
+в CRC берется из таблицы, посчитанной на этапе компиляции
+*/
+
+#ifndef LIB_FRAMETEMPLATE_HPP
+#define LIB_FRAMETEMPLATE_HPP
+
+#include "RsParser.hpp"
+#include "RsTypes.hpp"
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace RS {
+
+namespace Detail {
+
+/// \brief Таблица вклада байта на позиции Offset в CRC блока длиной Length: crc(блок с байтом) ^ crc(блок с нулем).
+/// Для линейной (в том числе с начальным значением и финальным XOR) CRC не зависит от остальных байт блока
+/// \tparam Crc CRC с constexpr update(uint8_t aChecksum, uint8_t aValue)
+template<typename Crc, size_t Length, size_t Offset>
+constexpr std::array<uint8_t, 256> makeByteContribution()
+{
+	std::array<uint8_t, 256> result{};
+
+	for (size_t value = 0; value < result.size(); ++value) {
+		uint8_t with{0};
+		uint8_t without{0};
+
+		for (size_t i = 0; i < Length; ++i) {
+			with = Crc::update(with, i == Offset ? static_cast<uint8_t>(value) : uint8_t{0});
+			without = Crc::update(without, uint8_t{0});
+		}
+
+		result[value] = static_cast<uint8_t>(with ^ without);
+	}
+
+	return result;
+}
+
+/// \brief Таблицы общие для всех сообщений одной длины
+template<typename Crc, size_t Length, size_t Offset>
+inline constexpr std::array<uint8_t, 256> kByteContribution{makeByteContribution<Crc, Length, Offset>()};
+
+} // namespace Detail
+
+/// \brief Заранее собранное сообщение
+/// \tparam Crc CRC протокола, должна предоставлять constexpr update(uint8_t aChecksum, uint8_t aValue)
+/// \tparam Message тип сообщения постоянного размера, Packet<Payload>
+template<typename Crc, typename Message>
+class FrameTemplate {
+	static constexpr size_t kLength{sizeof(Message)};
+	static constexpr size_t kReceiverOffset{offsetof(Header, receiverUID)};
+	static constexpr size_t kNumberOffset{offsetof(Header, number)};
+
+public:
+	/// \param aPrototype сообщение с отправителем, типом и полезной нагрузкой, receiverUID и number не используются
+	explicit FrameTemplate(const Message &aPrototype) :
+		frame{}
+	{
+		assign(aPrototype);
+	}
+
+	/// \brief Пересобрать заготовку, например при смене полезной нагрузки
+	/// \param aPrototype сообщение с отправителем, типом и полезной нагрузкой, receiverUID и number не используются
+	void assign(const Message &aPrototype)
+	{
+		memcpy(&frame[1], &aPrototype, kLength);
+		frame[1 + kReceiverOffset] = 0;
+		frame[1 + kNumberOffset] = 0;
+
+		RsParser<kLength + 2, Crc>::seal(frame, kLength);
+	}
+
+	/// \brief Записать сообщение с подставленными получателем и номером. Заготовка не меняется, поэтому
+	/// копирование из нее не упирается в только что записанные байты
+	/// \param aBuffer буфер размером не менее size()
+	/// \param aReceiverUID UID получателя
+	/// \param aNumber номер сообщения
+	/// \return size()
+	size_t emit(uint8_t *aBuffer, uint8_t aReceiverUID, uint8_t aNumber) const
+	{
+		memcpy(aBuffer, frame, sizeof(frame));
+		aBuffer[1 + kReceiverOffset] = aReceiverUID;
+		aBuffer[1 + kNumberOffset] = aNumber;
+		aBuffer[kLength + 1] = frame[kLength + 1] ^ Detail::kByteContribution<Crc, kLength, kReceiverOffset>[aReceiverUID]
+			^ Detail::kByteContribution<Crc, kLength, kNumberOffset>[aNumber];
+
+		return sizeof(frame);
+	}
+
+	/// \return Длина сообщения вместе с преамбулой и CRC
+	static constexpr size_t size()
+	{
+		return kLength + 2;
+	}
+
+private:
+	uint8_t frame[kLength + 2]; // Сообщение с нулевыми receiverUID и number
+};
+
+} // namespace RS
+
+#endif // LIB_FRAMETEMPLATE_HPP
@@ -25,7 +25,18 @@ class MultiNode {
 public:
 	template<typename... ARGs>
 	MultiNode(const std::tuple<ARGs...> &args) : devices{args}
+	{ }
+
+	/// \brief Включить или выключить фильтр получателей парсера (по умолчанию выключен), см. RsStaticHandler::setReceiverFilter
+	/// \param aEnabled true - принимать только сообщения для нод композита и широковещательные
+	void setReceiverFilter(bool aEnabled)
 	{
+		static_assert(!(Ts::kCachesResponses || ...), "ResponseCache must see frames for other nodes to expire its entries");
+		parser.clearReceiverFilter();
+
+		if (aEnabled) {
+			std::apply([this](auto &...device) { (parser.addReceiverFilter(device.getUid()), ...); }, devices);
+		}
 	}
 
 	/// \brief Основная функция, прокидывающая получаемые байты в парсер и отправляющие в протокольный обработчик
@@ -33,36 +44,15 @@ public:
 	/// \param aLength размер валидных данных
 	void update(const uint8_t *aData, size_t aLength)
 	{
-		size_t left = aLength;
-
-		while (left) {
-			size_t parsed = parser.update(static_cast<const uint8_t *>(aData) + (aLength - left), left);
-
-			if (parsed == 0) {
-				parser.reset();
-				break;
-			}
-
-			left -= parsed;
-			if (parser.state() == Parser::State::Done) {
-				routeMessage(parser.data(), parser.length());
-				parser.reset();
-			}
-		}
+		parser.parse(aData, aLength, [this](const uint8_t *aFrame, size_t aFrameLength) { routeMessage(aFrame, aFrameLength); });
 	}
 
 private:
-	/// \brief Функция маршрутизации для устройств
+	/// \brief Функция маршрутизации для устройств. Сообщение получают все ноды: чужие сообщения process() только
+	/// учитывает для кэша ответов
 	void routeMessage(const uint8_t *aMessage, size_t aLength)
 	{
-		const uint8_t targetUID = Parser::getReceiverFromPayload(aMessage, aLength);
-
-		std::apply(
-			[&](auto &...device)
-			{
-				(((device.getUid() == targetUID || targetUID == RS::kReservedUID) ? device.process(aMessage, aLength) : void()), ...);
-			},
-			devices);
+		std::apply([&](auto &...device) { (device.process(aMessage, aLength), ...); }, devices);
 	}
 };
 
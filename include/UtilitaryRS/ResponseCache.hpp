@@ -0,0 +1,193 @@
+/*!
+\file
+\brief Кэш последних ответов для повторно присланных запросов
+\author V-Nezlo (vlladimirka@gmail.com)
+\date 16.10.2026
+\version 1.0
+
+Если ответ потерялся на линии, отправитель повторяет запрос с тем же номером. Кэш хранит последний ответ
+каждому отправителю и по ключу (transmitUID, number, messageType) отдает его заново байт в байт, не вызывая
+обработчик второй раз: без повторного чтения датчика и повторной записи чанка во флеш.
+Хранится только последний обмен с отправителем: любое другое сообщение от него этой ноде сбрасывает запись.
+Между запросами одной ноде отправитель может говорить с другими, и если его номер общий для всех получателей
+(как у RsHandler), через 256 сообщений тот же номер придет снова. Поэтому кэш считает и сообщения отправителя
+другим нодам: после kMaxOverheard таких сообщений запись отбрасывается. Для этого обработчик должен видеть весь
+трафик шины - с ResponseCache фильтр получателей парсера не включается.
+DeviceHub не повторяет запросы с тем же номером, кэш полезен только с мастерами, которые повторяют запрос
+*/
+
+#ifndef LIB_RESPONSECACHE_HPP
+#define LIB_RESPONSECACHE_HPP
+
+#include "RsTypes.hpp"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace RS {
+
+/// \brief Кэш отключен, все вызовы пустые
+class NoResponseCache {
+public:
+	const uint8_t *find(uint8_t /*aTransmitUID*/, uint8_t /*aNumber*/, MessageType /*aType*/, size_t & /*aLength*/)
+	{
+		return nullptr;
+	}
+
+	void capture(const uint8_t * /*aFrame*/, size_t /*aLength*/) {}
+
+	void expect(uint8_t /*aTransmitUID*/, uint8_t /*aNumber*/, MessageType /*aType*/) {}
+
+	void disarm() {}
+
+	void overheard(uint8_t /*aTransmitUID*/) {}
+};
+
+/// \brief Кэш ответов
+/// \tparam Senders число отправителей, для которых хранится последний ответ
+/// \tparam FrameSize максимальный размер хранимого ответа вместе с преамбулой и CRC, большие ответы не кэшируются
+template<size_t Senders, size_t FrameSize>
+class ResponseCache {
+	static_assert(Senders > 0, "ResponseCache needs at least one slot");
+	static_assert(FrameSize >= sizeof(Header) + 2, "ResponseCache frame is too small");
+
+	struct Slot {
+		bool valid;
+		uint8_t transmitUID;
+		uint8_t number;
+		MessageType type;
+		uint8_t overheard; // Сообщений отправителя другим нодам после запроса, до kMaxOverheard
+		size_t length;
+		uint8_t frame[FrameSize];
+	};
+
+public:
+	/// \brief Сколько сообщений отправителя другим нодам переживает запись. Половина диапазона номеров: ложный
+	/// повтор возможен, только если нода пропустила больше половины сообщений отправителя
+	static constexpr uint8_t kMaxOverheard{128};
+
+	ResponseCache() :
+		slots{},
+		next{0},
+		armed{nullptr}
+	{ }
+
+	/// \brief Сообщения, обработчики которых имеют побочные эффекты - только их ответы кэшируются
+	static constexpr bool isCacheable(MessageType aType)
+	{
+		switch (aType) {
+			case MessageType::Command:
+			case MessageType::BlobRequest:
+			case MessageType::FileWriteRequest:
+			case MessageType::FileWriteChunk:
+			case MessageType::FileWriteFinalize:
+			case MessageType::Reboot:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	/// \brief Найти ответ на повтор запроса. При промахе запись отправителя сбрасывается и, если запрос
+	/// кэшируемый, следующий ответ ему запоминается через capture
+	/// \param aTransmitUID отправитель запроса
+	/// \param aNumber номер запроса
+	/// \param aType тип запроса
+	/// \param aLength длина найденного ответа
+	/// \return ответ или nullptr
+	const uint8_t *find(uint8_t aTransmitUID, uint8_t aNumber, MessageType aType, size_t &aLength)
+	{
+		Slot &slot = slotFor(aTransmitUID);
+
+		if (slot.valid && slot.overheard < kMaxOverheard && slot.number == aNumber && slot.type == aType) {
+			aLength = slot.length;
+			return slot.frame;
+		}
+
+		slot.valid = false;
+		slot.transmitUID = aTransmitUID;
+		slot.number = aNumber;
+		slot.type = aType;
+		slot.overheard = 0;
+		armed = isCacheable(aType) ? &slot : nullptr;
+		return nullptr;
+	}
+
+	/// \brief Запомнить отправленное сообщение, если это ответ на запрос, переданный в find
+	/// \param aFrame сообщение с преамбулой и CRC
+	/// \param aLength длина сообщения
+	void capture(const uint8_t *aFrame, size_t aLength)
+	{
+		if (armed == nullptr || aLength > FrameSize || aLength < sizeof(Header) + 2) {
+			return;
+		}
+
+		const auto *header = reinterpret_cast<const Header *>(aFrame + 1);
+
+		if (header->receiverUID == armed->transmitUID && header->number == armed->number) {
+			memcpy(armed->frame, aFrame, aLength);
+			armed->length = aLength;
+			armed->valid = true;
+			armed = nullptr;
+		}
+	}
+
+	/// \brief Заменить запомненный ответ следующим отправленным, например окончательным ответом после Ack(Wait).
+	/// Если отправитель уже прислал другое сообщение, запись не трогается
+	/// \param aTransmitUID отправитель запроса
+	/// \param aNumber номер запроса
+	/// \param aType тип запроса
+	void expect(uint8_t aTransmitUID, uint8_t aNumber, MessageType aType)
+	{
+		for (auto &slot : slots) {
+			if (slot.transmitUID == aTransmitUID && slot.number == aNumber && slot.type == aType) {
+				slot.valid = false;
+				armed = &slot;
+				return;
+			}
+		}
+	}
+
+	/// \brief Закончить обработку запроса
+	void disarm()
+	{
+		armed = nullptr;
+	}
+
+	/// \brief Учесть сообщение отправителя другой ноде, его номер приближает переполнение счетчика отправителя
+	/// \param aTransmitUID отправитель сообщения
+	void overheard(uint8_t aTransmitUID)
+	{
+		for (auto &slot : slots) {
+			// Считаем и пока ответ не запомнен (отложенный ответ): номер отсчитывается от запроса
+			if (slot.transmitUID == aTransmitUID && slot.overheard < kMaxOverheard) {
+				++slot.overheard;
+			}
+		}
+	}
+
+private:
+	Slot slots[Senders];
+	size_t next;
+	Slot *armed;
+
+	/// \brief Слот отправителя, при его отсутствии - следующий по кругу
+	Slot &slotFor(uint8_t aTransmitUID)
+	{
+		for (auto &slot : slots) {
+			if (slot.transmitUID == aTransmitUID) {
+				return slot;
+			}
+		}
+
+		Slot &slot = slots[next];
+		next = (next + 1) % Senders;
+		slot.valid = false;
+		return slot;
+	}
+};
+
+} // namespace RS
+
+#endif // LIB_RESPONSECACHE_HPP
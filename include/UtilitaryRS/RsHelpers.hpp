@@ -10,6 +10,7 @@
 #ifndef LIB_RSHELPERS_HPP
 #define LIB_RSHELPERS_HPP
 
+#include "RsLayout.hpp"
 #include "RsTypes.hpp"
 #include <string>
 #include <string.h>
@@ -21,59 +22,19 @@ namespace RS::Helpers {
 /// \return длина сообщения или 0 если сообщение переменного размера
 static constexpr size_t getMessageSizeByType(MessageType aType)
 {
-	switch(aType) {
-		case MessageType::Ack:
-			return sizeof(AckMessage);
-		case MessageType::Command:
-			return sizeof(ComMessage);
-		case MessageType::Probe:
-			return sizeof(ProbeMessage);
-		case MessageType::Reboot:
-			return sizeof(RebootMessage);
-		case MessageType::DeviceInfoReq:
-			return sizeof(DeviceInfoReqMessage);
-		case MessageType::BlobRequest:
-			return sizeof(BlobReqMessage);
-		case MessageType::FileWriteFinalize:
-			return sizeof(FileWriteFinalizeMessage);
-		case MessageType::FileWriteRequest:
-			return sizeof(FileWriteRequestMessage);
-		case MessageType::HealthReq:
-			return sizeof(HealthReqMessage);
-		case MessageType::HealthAnw:
-			return sizeof(HealthAnwMessage);
-
-		default:
-			return 0;
-	}
+	const auto &layout = DefaultMessageLayout::get(aType);
+	return layout.isVolatile() ? 0 : layout.size;
 }
 
 static constexpr size_t getVolatileMessageBaseSize(MessageType aType)
 {
-	switch(aType) {
-		case MessageType::BlobAnswer:
-			return sizeof(BlobAnwMessage);
-		case MessageType::FileWriteChunk:
-			return sizeof(FileWriteChunkMessage);
-		case MessageType::DeviceInfoAnw:
-			return sizeof(DeviceInfoAnwMessage);
-		default:
-			return 0;
-	}
+	const auto &layout = DefaultMessageLayout::get(aType);
+	return layout.isVolatile() ? layout.size : 0;
 }
 
 static constexpr size_t getVolatileMessageMaxPayloadSize(MessageType aType)
 {
-	switch(aType) {
-		case MessageType::BlobAnswer:
-			return 0xFF;
-		case MessageType::FileWriteChunk:
-			return 0xFF;
-		case MessageType::DeviceInfoAnw:
-			return 0xFF;
-		default:
-			return 0;
-	}
+	return DefaultMessageLayout::get(aType).maxPayload;
 }
 
 std::string retToString(Result aResult)
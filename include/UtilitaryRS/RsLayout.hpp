@@ -0,0 +1,169 @@
+/*!
+\file
+\brief Таблица размеров сообщений протокола UtilitaryRS, собираемая на этапе компиляции
+\author V-Nezlo (vlladimirka@gmail.com)
+\date 16.10.2026
+\version 1.0
+
+*/
+
+#ifndef LIB_RSLAYOUT_HPP
+#define LIB_RSLAYOUT_HPP
+
+#include "RsTypes.hpp"
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+namespace RS {
+
+/// \brief Описание размеров одного типа сообщения
+struct MessageLayout {
+	/// Размер сообщения (header+payload) для постоянных сообщений или размер базовой части для переменных,
+	/// 0 если тип не поддерживается
+	uint16_t size;
+	/// Максимальный размер хвоста переменного сообщения, 0 для постоянных сообщений
+	uint16_t maxPayload;
+
+	constexpr bool isSupported() const
+	{
+		return size != 0;
+	}
+
+	constexpr bool isVolatile() const
+	{
+		return maxPayload != 0;
+	}
+};
+
+/// \brief Запись таблицы
+/// \tparam Type тип сообщения
+/// \tparam Message пакет (Packet<...>), для переменных сообщений последний байт пакета - длина хвоста
+/// \tparam MaxPayload максимальный размер хвоста, 0 для сообщений постоянного размера
+template<MessageType Type, typename Message, size_t MaxPayload = 0>
+struct LayoutEntry {
+	static_assert(sizeof(Message) >= sizeof(Header), "Message must start with RS::Header");
+	static_assert(sizeof(Message) <= UINT16_MAX && MaxPayload <= UINT8_MAX, "Message is too big");
+	static_assert(MaxPayload == 0 || sizeof(Message) > sizeof(Header), "Volatile message must contain a length byte");
+
+	static constexpr MessageType type{Type};
+	static constexpr MessageLayout layout{static_cast<uint16_t>(sizeof(Message)), static_cast<uint16_t>(MaxPayload)};
+};
+
+/// \brief Таблица размеров сообщений, индексируемая типом сообщения
+/// Расширяется пользовательскими типами через Extend: MessageLayoutTable<...>::Extend<LayoutEntry<...>>
+/// \tparam Entries набор LayoutEntry, типы не должны повторяться
+template<typename... Entries>
+class MessageLayoutTable {
+	static constexpr std::array<MessageLayout, 256> build()
+	{
+		std::array<MessageLayout, 256> result{};
+		((result[static_cast<uint8_t>(Entries::type)] = Entries::layout), ...);
+		return result;
+	}
+
+	static constexpr bool unique()
+	{
+		std::array<uint8_t, 256> count{};
+		((++count[static_cast<uint8_t>(Entries::type)]), ...);
+
+		for (auto value : count) {
+			if (value > 1) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static_assert(unique(), "Message type is declared twice");
+
+public:
+	template<typename... Others>
+	using Extend = MessageLayoutTable<Entries..., Others...>;
+
+	static constexpr std::array<MessageLayout, 256> table{build()};
+
+	/// \brief Получить описание сообщения
+	/// \param aType тип сообщения
+	/// \return описание, для неподдерживаемых типов все поля нулевые
+	static constexpr const MessageLayout &get(MessageType aType)
+	{
+		return table[static_cast<uint8_t>(aType)];
+	}
+};
+
+/// \brief Стандартные сообщения протокола
+using DefaultMessageLayout = MessageLayoutTable<
+	LayoutEntry<MessageType::Probe, ProbeMessage>,
+	LayoutEntry<MessageType::Ack, AckMessage>,
+	LayoutEntry<MessageType::Command, ComMessage>,
+	LayoutEntry<MessageType::BlobRequest, BlobReqMessage>,
+	LayoutEntry<MessageType::BlobAnswer, BlobAnwMessage, 0xFF>,
+	LayoutEntry<MessageType::DeviceInfoReq, DeviceInfoReqMessage>,
+	LayoutEntry<MessageType::DeviceInfoAnw, DeviceInfoAnwMessage, 0xFF>,
+	LayoutEntry<MessageType::FileWriteRequest, FileWriteRequestMessage>,
+	LayoutEntry<MessageType::FileWriteChunk, FileWriteChunkMessage, 0xFF>,
+	LayoutEntry<MessageType::FileWriteFinalize, FileWriteFinalizeMessage>,
+	LayoutEntry<MessageType::HealthReq, HealthReqMessage>,
+	LayoutEntry<MessageType::HealthAnw, HealthAnwMessage>,
+	LayoutEntry<MessageType::Reboot, RebootMessage>>;
+
+/// \brief Набор стандартных типов сообщений, бит N соответствует MessageType с номером N
+using MessageSet = uint32_t;
+
+static_assert(static_cast<uint8_t>(MessageType::TypeEnd) <= 32, "MessageSet is too narrow for standard messages");
+
+/// \brief Бит типа сообщения в наборе
+constexpr MessageSet messageBit(MessageType aType)
+{
+	return static_cast<uint8_t>(aType) < 32 ? MessageSet{1} << static_cast<uint8_t>(aType) : 0;
+}
+
+/// \brief Набор из перечисленных типов: kMessages<MessageType::Probe, MessageType::Command>
+template<MessageType... Types>
+inline constexpr MessageSet kMessages{(messageBit(Types) | ... | MessageSet{0})};
+
+/// \brief Все стандартные сообщения протокола
+inline constexpr MessageSet kAllMessages{messageBit(MessageType::TypeEnd) - 1};
+
+/// \brief Таблица, в которой стандартные типы вне набора помечены неподдерживаемыми, парсер отбрасывает их на этапе
+/// заголовка. Пользовательские типы с номерами от 32 не фильтруются
+/// \tparam Layout исходная таблица (MessageLayoutTable)
+/// \tparam Supported набор поддерживаемых стандартных типов
+template<typename Layout, MessageSet Supported>
+class FilteredMessageLayout {
+	static constexpr std::array<MessageLayout, 256> build()
+	{
+		std::array<MessageLayout, 256> result = Layout::table;
+
+		for (size_t type = 0; type < 32; ++type) {
+			if (!(Supported & (MessageSet{1} << type))) {
+				result[type] = MessageLayout{};
+			}
+		}
+
+		return result;
+	}
+
+public:
+	static constexpr std::array<MessageLayout, 256> table{build()};
+
+	/// \brief Получить описание сообщения
+	/// \param aType тип сообщения
+	/// \return описание, для неподдерживаемых типов все поля нулевые
+	static constexpr const MessageLayout &get(MessageType aType)
+	{
+		return table[static_cast<uint8_t>(aType)];
+	}
+};
+
+/// \brief Стандартная таблица, ограниченная набором Supported, без копии таблицы для полного набора
+template<MessageSet Supported>
+using SupportedMessageLayout = std::conditional_t<(Supported & kAllMessages) == kAllMessages, DefaultMessageLayout,
+	FilteredMessageLayout<DefaultMessageLayout, Supported>>;
+
+} // namespace RS
+
+#endif // LIB_RSLAYOUT_HPP
@@ -8,7 +8,10 @@
 
 #include "RsTypes.hpp"
 #include "RsHelpers.hpp"
+#include "RsLayout.hpp"
+#include "RsStats.hpp"
 
+#include <algorithm>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
@@ -18,145 +21,159 @@
 
 namespace RS {
 
-template<size_t BufferSize, typename CRC>
+/// \brief Представление готового сообщения (header+payload, без преамбулы и CRC)
+struct FrameView {
+	const uint8_t *data;
+	size_t length;
+};
+
+/// \brief Парсер протокола UtilitaryRS
+/// \tparam BufferSize размер внутреннего буфера сообщения
+/// \tparam CRC политика контрольной суммы, должна предоставлять потоковые update(checksum, byte) и
+/// update(checksum, data, length)
+/// \tparam Layout таблица размеров сообщений (MessageLayoutTable), по умолчанию стандартные сообщения протокола
+/// \tparam Stats политика счетчиков канального уровня: LinkStats или NoLinkStats (счетчики не компилируются)
+template<size_t BufferSize, typename CRC, typename Layout = DefaultMessageLayout, typename Stats = NoLinkStats>
 class RsParser {
 	struct BufferedMessage {
-		MessageType type;
+		MessageLayout layout;
 		size_t chunkSize;
+		/// Сообщение другой ноде - CRC не считается по мере приема
+		bool foreign;
 	};
 
+	/// \brief Результат проверки сообщения прямо во входном буфере
+	enum class InPlace { Incomplete, Valid, BadHeader, Oversize, BadCrc, Foreign };
+
 public:
 	enum class State { Idle, Header, ConstPayload, VolatilePayload, Crc, Done };
 	static constexpr uint8_t kInitChecksum{0x00};
 
-	RsParser() : position{0}, parserState{State::Idle}, buffer{}, message{}
+	RsParser() :
+		position{0},
+		parserState{State::Idle},
+		checksum{kInitChecksum},
+		buffer{},
+		view{nullptr},
+		replayBegin{0},
+		replayEnd{0},
+		filtered{false},
+		receivers{},
+		message{},
+		linkStats{}
 	{ }
 
 	/// \brief Основная функция парсера
+	/// Если сообщение целиком лежит во входном буфере, оно не копируется - data() будет указывать прямо на aBuffer,
+	/// поэтому готовое сообщение нужно обработать до того, как aBuffer будет изменен.
+	/// Если кандидат в сообщение оказался ложным, принятые после его преамбулы байты просматриваются заново, поэтому
+	/// сообщение может быть готово и без новых входных данных (возвращаемое значение при этом может быть 0)
 	/// \param aBuffer указатель на данные, которые нужно отпарсить
 	/// \param aLength длина пришедших данных для парсинга
 	/// \return возвращает количество отпарcенных байт
 	size_t update(const uint8_t *aBuffer, size_t aLength)
 	{
 		if (isReady()) {
-			reset();
+			restart();
 		}
 
-		for (size_t i = 0; i < aLength; ++i) {
-			if (isReady()) {
-				return i;
-			}
-
-			const uint8_t value = *(static_cast<const uint8_t *>(aBuffer) + i);
-
-			switch (parserState) {
-				case State::Idle:
-					if (value == kPreambl) {
-						parserState = State::Header;
-					}
-					break;
-				case State::Header:
-					if (position < sizeof(Header)) {
-						buffer[position] = value;
-						++position;
-
-						if (position == offsetof(Header, messageType) + 1) {
-							message.type = static_cast<MessageType>(value);
-						}
-
-						if (position == sizeof(Header)) {
-							if (message.type >= MessageType::TypeEnd) {
-								reset();
-								return i;
-							}
-
-							if (Helpers::getMessageSizeByType(message.type)) {
-								parserState = State::ConstPayload;
-							} else {
-								parserState = State::VolatilePayload;
-							}
-							break;
-						}
-					} else {
-						reset();
-						return i;
-					}
-					break;
-
-				case State::ConstPayload: {
-					const size_t messageSize = Helpers::getMessageSizeByType(message.type);
-					if (position < messageSize) {
-						buffer[position] = value;
+		size_t i = 0;
 
-						++position;
-
-						if (position == messageSize) {
-							parserState = State::Crc;
-						}
-					} else {
-						reset();
-						return i;
-					}
-					} break;
+		while (!isReady()) {
+			if (replayBegin != replayEnd) {
+				replay();
+			} else if (i < aLength) {
+				i += consume(aBuffer + i, aLength - i);
+			} else {
+				break;
+			}
+		}
 
-				case State::VolatilePayload: {
-					const size_t baseSize = Helpers::getVolatileMessageBaseSize(message.type);
-					const size_t payloadMaxSize = Helpers::getVolatileMessageMaxPayloadSize(message.type);
+		linkStats.received(i);
+		return i;
+	}
 
-					if (baseSize == 0 || payloadMaxSize == 0) {
-						// Сообщение не поддерживается, сброс
-						reset();
-						return i;
-					}
+	/// \brief Пакетный разбор - обрабатывает весь буфер за один вызов и отдает каждое найденное сообщение
+	/// \param aBuffer указатель на данные, которые нужно отпарсить
+	/// \param aLength длина пришедших данных для парсинга
+	/// \param aVisitor обработчик вида void(const uint8_t *aFrame, size_t aLength), вызывается для каждого сообщения
+	/// \return количество найденных сообщений
+	template<typename Visitor>
+	size_t parse(const uint8_t *aBuffer, size_t aLength, Visitor &&aVisitor)
+	{
+		size_t offset = 0;
+		size_t frames = 0;
 
-					if (position < baseSize) {
-						buffer[position] = value;
-						++position;
+		if (isReady()) {
+			restart();
+		}
 
-						if (position == baseSize) {
-							message.chunkSize = value;
+		while (offset < aLength || replayBegin != replayEnd) {
+			// Сообщения подряд целиком во входном буфере отдаем без захода в автомат и без изменения его состояния
+			if (parserState == State::Idle && replayBegin == replayEnd && aBuffer[offset] == kPreambl) {
+				size_t frameSize = 0;
+
+				const InPlace result = checkInPlace(aBuffer + offset + 1, aLength - offset - 1, frameSize);
+
+				if (result == InPlace::Valid) {
+					linkStats.received(frameSize + 2);
+					linkStats.accepted(static_cast<MessageType>(aBuffer[offset + 1 + offsetof(Header, messageType)]));
+					aVisitor(aBuffer + offset + 1, frameSize);
+					offset += frameSize + 2;
+					++frames;
+					continue;
+				} else if (result == InPlace::Foreign) {
+					linkStats.received(frameSize + 2);
+					linkStats.foreign();
+					offset += frameSize + 2;
+					continue;
+				}
+			}
 
-							if (message.chunkSize > payloadMaxSize) {
-								reset();
-								return i;
-							}
-						}
-					} else if (position < baseSize + payloadMaxSize) {
-						buffer[position] = value;
-						++position;
+			offset += update(aBuffer + offset, aLength - offset);
 
-						if (position == baseSize + message.chunkSize) {
-							parserState = State::Crc;
-							break;
-						}
-					}
+			if (isReady()) {
+				aVisitor(data(), position);
+				restart();
+				++frames;
+			} else if (offset == aLength) {
+				break;
+			}
+		}
 
-					} break;
+		return frames;
+	}
 
-				case State::Crc: {
-					uint8_t crc = CRC::calculate(buffer, position);
+	/// \brief Пакетный разбор в массив представлений. Представления указывают во входной буфер, кроме сообщений,
+	/// собранных во внутреннем буфере (начатых в предыдущем вызове или найденных после ложной преамбулы), - на них
+	/// разбор останавливается, так как следующее сообщение может их перезаписать
+	/// \param aBuffer указатель на данные, которые нужно отпарсить
+	/// \param aLength длина пришедших данных для парсинга
+	/// \param aFrames массив для найденных сообщений
+	/// \param aCapacity размер массива
+	/// \param aParsed количество обработанных байт, остаток нужно передать следующим вызовом
+	/// \return количество найденных сообщений
+	size_t parse(const uint8_t *aBuffer, size_t aLength, FrameView *aFrames, size_t aCapacity, size_t &aParsed)
+	{
+		size_t offset = 0;
+		size_t frames = 0;
 
-					if (crc == value) {
-						parserState = State::Done;
-					} else {
-						reset();
-					}
-				} break;
+		while ((offset < aLength || replayBegin != replayEnd) && frames < aCapacity) {
+			offset += update(aBuffer + offset, aLength - offset);
 
-				case State::Done:
-					break;
+			if (isReady()) {
+				aFrames[frames++] = frame();
 
-				default:
-					reset();
+				if (data() < aBuffer || data() >= aBuffer + aLength) {
 					break;
-			}
-
-			if (position >= BufferSize) {
-				reset();
-				return i;
+				}
+			} else if (offset == aLength) {
+				break;
 			}
 		}
-		return aLength;
+
+		aParsed = offset;
+		return frames;
 	}
 
 	/// \brief Получить receiver сообщения из самого сообщения (полное сообщение, включая преамбулу)
@@ -210,9 +227,22 @@ public:
 	{
 		uint8_t *const pos = static_cast<uint8_t *>(aBuffer);
 
+		// Данные могут уже лежать на месте (aData == aBuffer + 1)
+		memmove(&pos[1], aData, aLength);
+		return seal(pos, aLength);
+	}
+
+	/// \brief Завершает сообщение, собранное прямо в буфере отправки: header+payload уже лежат с aBuffer + 1,
+	/// дописываются преамбула и CRC
+	/// \param aBuffer буфер размером не менее aLength + 2
+	/// \param aLength длина header+payload
+	/// \return возвращает конечную длину сообщения UtilitaryRS
+	static size_t seal(void *aBuffer, size_t aLength)
+	{
+		uint8_t *const pos = static_cast<uint8_t *>(aBuffer);
+
 		pos[0] = kPreambl;
-		memcpy(&pos[1], aData, aLength);
-		pos[aLength + 1] = CRC::calculate(aData, aLength);
+		pos[aLength + 1] = CRC::calculate(&pos[1], aLength);
 
 		return aLength + 2;
 	}
@@ -223,10 +253,16 @@ public:
 		return parserState;
 	}
 
-	/// \return Возвращает указатель на сырые данные парсера
+	/// \return Возвращает указатель на сырые данные парсера (или на входной буфер, если сообщение не копировалось)
 	const uint8_t *data() const
 	{
-		return buffer;
+		return view != nullptr ? view : buffer;
+	}
+
+	/// \return Возвращает представление готового сообщения
+	FrameView frame() const
+	{
+		return FrameView{data(), position};
 	}
 
 	/// \return Возвращает текущую позицию парсера
@@ -235,12 +271,58 @@ public:
 		return position;
 	}
 
-	/// \brief Сброс парсера
+	/// \brief Принимать только сообщения для указанной ноды и широковещательные. Сообщения другим нодам
+	/// пропускаются по длине из заголовка без проверки CRC. CRC чужого сообщения все же проверяется, если в нем
+	/// встречается преамбула: иначе ложная преамбула в шуме скрыла бы идущее за ней настоящее сообщение
+	/// \param aUID UID ноды
+	void setReceiverFilter(uint8_t aUID)
+	{
+		clearReceiverFilter();
+		addReceiverFilter(aUID);
+	}
+
+	/// \brief Добавить UID в фильтр получателей (например, для нескольких нод за одним парсером)
+	/// \param aUID UID ноды
+	void addReceiverFilter(uint8_t aUID)
+	{
+		receivers[aUID / 32] |= 1UL << (aUID % 32);
+		filtered = true;
+	}
+
+	/// \brief Выключить фильтр получателей - принимаются все сообщения
+	void clearReceiverFilter()
+	{
+		for (auto &word : receivers) {
+			word = 0;
+		}
+		filtered = false;
+	}
+
+	/// \brief Проверить, будет ли принято сообщение для данного получателя
+	/// \param aUID UID получателя
+	/// \return true если сообщение будет принято
+	bool isAccepted(uint8_t aUID) const
+	{
+		return !filtered || aUID == kReservedUID || (receivers[aUID / 32] & (1UL << (aUID % 32)));
+	}
+
+	/// \return Счетчики канального уровня, снимок через stats().snapshot() можно брать параллельно с приемом
+	Stats &stats()
+	{
+		return linkStats;
+	}
+
+	const Stats &stats() const
+	{
+		return linkStats;
+	}
+
+	/// \brief Сброс парсера, включая байты, ожидающие повторного просмотра
 	void reset()
 	{
-		position = 0;
-		parserState = State::Idle;
-		message = {};
+		restart();
+		replayBegin = 0;
+		replayEnd = 0;
 	}
 
 	bool isReady() const
@@ -251,10 +333,319 @@ public:
 private:
 	size_t position;
 	State parserState;
+	uint8_t checksum;
 	uint8_t buffer[BufferSize];
+	const uint8_t *view;
+	size_t replayBegin;
+	size_t replayEnd;
+	bool filtered;
+	uint32_t receivers[8];
 	BufferedMessage message;
+	Stats linkStats;
 
 	static constexpr char kPreambl{'R'};
+
+	/// \brief Прогнать данные через автомат парсера
+	/// \param aBuffer указатель на данные
+	/// \param aLength длина данных
+	/// \return количество обработанных байт, обработка прерывается на готовом сообщении и на ложной преамбуле
+	size_t consume(const uint8_t *aBuffer, size_t aLength)
+	{
+		size_t i = 0;
+
+		while (i < aLength && !isReady()) {
+			switch (parserState) {
+				case State::Idle: {
+					// Обычно сообщения идут подряд и преамбула стоит сразу, иначе пропускаем мусор целиком через memchr
+					if (aBuffer[i] != kPreambl) {
+						const void *preambl = memchr(aBuffer + i + 1, kPreambl, aLength - i - 1);
+
+						if (preambl == nullptr) {
+							linkStats.discarded(aLength - i);
+							return aLength;
+						}
+
+						const size_t next = static_cast<size_t>(static_cast<const uint8_t *>(preambl) - aBuffer);
+						linkStats.discarded(next - i);
+						i = next;
+					}
+
+					++i;
+					parserState = State::Header;
+
+					size_t frameSize = 0;
+					const InPlace result = checkInPlace(aBuffer + i, aLength - i, frameSize);
+
+					switch (result) {
+						case InPlace::Valid:
+							// Сообщение целиком во входном буфере и CRC сошелся - отдаем без копирования
+							view = aBuffer + i;
+							position = frameSize;
+							parserState = State::Done;
+							linkStats.accepted(static_cast<MessageType>(view[offsetof(Header, messageType)]));
+							return i + frameSize + 1;
+						case InPlace::BadHeader:
+						case InPlace::Oversize:
+						case InPlace::BadCrc:
+							// Ложная преамбула - ищем следующую сразу за ней, настоящее сообщение может быть внутри
+							countReject(result);
+							parserState = State::Idle;
+							break;
+						case InPlace::Foreign:
+							// Сообщение другой ноде целиком во входном буфере - просто перешагиваем
+							linkStats.foreign();
+							parserState = State::Idle;
+							i += frameSize + 1;
+							break;
+						case InPlace::Incomplete:
+							break;
+					}
+				} break;
+
+				case State::Header:
+					if (position == offsetof(Header, receiverUID)) {
+						message.foreign = !isAccepted(aBuffer[i]);
+					}
+
+					i += store(aBuffer + i, std::min(sizeof(Header) - position, aLength - i));
+
+					if (position == sizeof(Header)) {
+						// Размеры сообщения берем из таблицы один раз на сообщение
+						message.layout = Layout::get(static_cast<MessageType>(buffer[offsetof(Header, messageType)]));
+
+						if (!message.layout.isSupported()) {
+							linkStats.headerReject();
+							resync();
+							return i;
+						}
+
+						if (message.layout.size >= BufferSize) {
+							linkStats.oversizeReject();
+							resync();
+							return i;
+						}
+
+						if (message.layout.isVolatile()) {
+							parserState = State::VolatilePayload;
+						} else if (position == message.layout.size) {
+							parserState = State::Crc;
+						} else {
+							parserState = State::ConstPayload;
+						}
+					}
+					break;
+
+				case State::ConstPayload: {
+					const size_t messageSize = message.layout.size;
+					i += store(aBuffer + i, std::min(messageSize - position, aLength - i));
+
+					if (position == messageSize) {
+						parserState = State::Crc;
+					}
+				} break;
+
+				case State::VolatilePayload: {
+					const size_t baseSize = message.layout.size;
+					const size_t payloadMaxSize = message.layout.maxPayload;
+
+					if (position < baseSize) {
+						i += store(aBuffer + i, std::min(baseSize - position, aLength - i));
+
+						if (position == baseSize) {
+							// Последний байт базовой части - длина хвоста
+							message.chunkSize = buffer[baseSize - 1];
+
+							if (message.chunkSize > payloadMaxSize || baseSize + message.chunkSize >= BufferSize) {
+								linkStats.oversizeReject();
+								resync();
+								return i;
+							}
+
+							if (message.chunkSize == 0) {
+								// Пустой хвост - сразу ждем CRC, иначе парсер навсегда застрянет в этом состоянии
+								parserState = State::Crc;
+							}
+						}
+					} else {
+						i += store(aBuffer + i, std::min(baseSize + message.chunkSize - position, aLength - i));
+
+						if (position == baseSize + message.chunkSize) {
+							parserState = State::Crc;
+						}
+					}
+				} break;
+
+				case State::Crc:
+					if (message.foreign && (!hidesPreambl(buffer, position, aBuffer[i])
+							|| CRC::update(kInitChecksum, buffer, position) == aBuffer[i])) {
+						// Чужое сообщение: CRC считается, только если внутри него могло начаться настоящее сообщение
+						linkStats.foreign();
+						restart();
+					} else if (!message.foreign && checksum == aBuffer[i]) {
+						// Контрольная сумма накоплена по мере приема, здесь только сравнение
+						parserState = State::Done;
+						linkStats.accepted(static_cast<MessageType>(buffer[offsetof(Header, messageType)]));
+					} else {
+						// Байт CRC тоже может оказаться началом настоящего сообщения
+						linkStats.crcFailure();
+						buffer[position++] = aBuffer[i];
+						resync();
+						return i + 1;
+					}
+					++i;
+					break;
+
+				default:
+					restart();
+					++i;
+					break;
+			}
+		}
+
+		return i;
+	}
+
+
+	/// \brief Проверить, может ли внутри сообщения начинаться другое сообщение
+	/// \param aData header+payload
+	/// \param aLength длина header+payload
+	/// \param aCrc байт CRC сообщения
+	/// \return true если в сообщении или в байте CRC есть преамбула
+	static bool hidesPreambl(const uint8_t *aData, size_t aLength, uint8_t aCrc)
+	{
+		return aCrc == kPreambl || memchr(aData, kPreambl, aLength) != nullptr;
+	}
+
+	/// \brief Учесть отброшенное в checkInPlace сообщение
+	/// \param aResult результат проверки
+	void countReject(InPlace aResult)
+	{
+		if (aResult == InPlace::BadHeader) {
+			linkStats.headerReject();
+		} else if (aResult == InPlace::Oversize) {
+			linkStats.oversizeReject();
+		} else {
+			linkStats.crcFailure();
+		}
+	}
+
+	/// \brief Отбросить ложную преамбулу, принятые после нее байты будут просмотрены заново
+	void resync()
+	{
+		const size_t pending = position;
+
+		restart();
+		replayBegin = 0;
+		replayEnd = pending;
+	}
+
+	/// \brief Разобрать байты, оставшиеся во внутреннем буфере после ложной преамбулы.
+	/// Автомат пишет в buffer не дальше, чем читает, поэтому источник и приемник могут совпадать
+	void replay()
+	{
+		const size_t begin = replayBegin;
+		const size_t end = replayEnd;
+
+		replayBegin = 0;
+		replayEnd = 0;
+
+		const size_t used = consume(buffer + begin, end - begin);
+		const size_t left = end - begin - used;
+
+		if (left == 0) {
+			return;
+		}
+
+		if (isReady()) {
+			// Остаток лежит за готовым сообщением, разберем его после обработки
+			replayBegin = begin + used;
+			replayEnd = end;
+		} else {
+			// Снова ложная преамбула - остаток идет следом за новыми байтами для повторного просмотра
+			memmove(&buffer[replayEnd], &buffer[begin + used], left);
+			replayEnd += left;
+		}
+	}
+
+	/// \brief Подготовка к следующему сообщению, непросмотренные байты сохраняются
+	void restart()
+	{
+		position = 0;
+		parserState = State::Idle;
+		checksum = kInitChecksum;
+		view = nullptr;
+		message = {};
+	}
+
+	/// \brief Сохранить во внутренний буфер сразу несколько байт сообщения
+	/// \param aData данные
+	/// \param aLength количество байт
+	/// \return количество сохраненных байт
+	size_t store(const uint8_t *aData, size_t aLength)
+	{
+		// При повторном просмотре источник лежит в том же буфере и может быть перезаписан, считаем по приемнику
+		memmove(&buffer[position], aData, aLength);
+		if (!message.foreign) {
+			checksum = CRC::update(checksum, &buffer[position], aLength);
+		}
+		position += aLength;
+		return aLength;
+	}
+
+	/// \brief Проверить, лежит ли сообщение целиком во входном буфере
+	/// \param aData данные сразу после преамбулы
+	/// \param aLength длина доступных данных
+	/// \param aFrameSize размер сообщения (header+payload), если оно определено
+	/// \return Valid если сообщение полное и CRC сошелся, BadHeader/Oversize/BadCrc если это ложная преамбула,
+	/// Foreign если полное сообщение адресовано другой ноде (CRC проверяется, только если в сообщении есть преамбула)
+	InPlace checkInPlace(const uint8_t *aData, size_t aLength, size_t &aFrameSize) const
+	{
+		if (aLength < sizeof(Header)) {
+			return InPlace::Incomplete;
+		}
+
+		const MessageLayout &layout = Layout::get(static_cast<MessageType>(aData[offsetof(Header, messageType)]));
+		if (!layout.isSupported()) {
+			return InPlace::BadHeader;
+		}
+
+		size_t frameSize = layout.size;
+
+		if (layout.isVolatile()) {
+			if (aLength < frameSize) {
+				return InPlace::Incomplete;
+			}
+
+			if (aData[frameSize - 1] > layout.maxPayload) {
+				return InPlace::Oversize;
+			}
+
+			frameSize += aData[frameSize - 1];
+		}
+
+		if (frameSize >= BufferSize) {
+			return InPlace::Oversize;
+		}
+
+		// Неполное сообщение дособерет основной автомат
+		if (aLength <= frameSize) {
+			return InPlace::Incomplete;
+		}
+
+		aFrameSize = frameSize;
+
+		const bool foreign = !isAccepted(aData[offsetof(Header, receiverUID)]);
+
+		if (foreign && !hidesPreambl(aData, frameSize, aData[frameSize])) {
+			return InPlace::Foreign;
+		}
+
+		if (CRC::update(kInitChecksum, aData, frameSize) != aData[frameSize]) {
+			return InPlace::BadCrc;
+		}
+
+		return foreign ? InPlace::Foreign : InPlace::Valid;
+	}
 };
 
 } // namespace RS
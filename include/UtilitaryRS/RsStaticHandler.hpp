@@ -0,0 +1,784 @@
+/*!
+\file
+\brief Обработчик протокола со статической диспетчеризацией (CRTP)
+\author V-Nezlo (vlladimirka@gmail.com)
+\date 16.10.2026
+\version 1.0
+
+Обработчики сообщений берутся из наследника на этапе компиляции, без виртуальных вызовов: наследник объявляет
+только нужные ему обработчики с теми же сигнатурами, остальные остаются обработчиками по умолчанию
+(Result::Unsupported). Вызовы обработчиков встраиваются в process(). RsHandler - тонкий адаптер с виртуальным
+API поверх этого класса
+*/
+
+#ifndef LIB_RSSTATICHANDLER_HPP
+#define LIB_RSSTATICHANDLER_HPP
+
+#include "BlobSource.hpp"
+#include "FrameTemplate.hpp"
+#include "ResponseCache.hpp"
+#include "RsParser.hpp"
+#include "RsTypes.hpp"
+
+#include <assert.h>
+#include <atomic>
+#include <type_traits>
+#include <utility>
+
+namespace RS {
+
+namespace Detail {
+
+/// \brief Проверка, умеет ли интерфейс выдавать область для записи сообщения по месту
+template<typename T, typename = void>
+struct HasReserve : std::false_type {};
+
+template<typename T>
+struct HasReserve<T, std::void_t<decltype(std::declval<T &>().reserve(size_t{})), decltype(std::declval<T &>().commit(size_t{}))>>
+	: std::true_type {};
+
+/// \brief Проверка, копит ли интерфейс сообщения до явного flush()
+template<typename T, typename = void>
+struct HasFlush : std::false_type {};
+
+template<typename T>
+struct HasFlush<T, std::void_t<decltype(std::declval<T &>().flush())>> : std::true_type {};
+
+/// \brief Участок, который не должен выполняться одновременно с другим таким же: прием (process) и завершение
+/// отложенного ответа пишут в один буфер сообщения, интерфейс и кэш. Нарушение ловится assert в отладочной сборке
+class ExclusiveSection {
+public:
+	explicit ExclusiveSection(std::atomic<bool> &aBusy) : busy{aBusy}
+	{
+		assert(!busy.load(std::memory_order_relaxed) && "update() and complete* must run in one context");
+		busy.store(true, std::memory_order_relaxed);
+	}
+
+	~ExclusiveSection()
+	{
+		busy.store(false, std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<bool> &busy;
+};
+
+} // namespace Detail
+
+/// \brief Запрос, ответ на который будет отправлен позже, см. RsStaticHandler::defer
+struct PendingAnswer {
+	uint8_t transmitUID;
+	uint8_t number;
+	MessageType type;
+	uint8_t request; // Только для BlobRequest
+	uint8_t dataSize; // Только для BlobRequest
+};
+
+/// \brief Обработчик протокола со статической диспетчеризацией
+/// \tparam Derived наследник, предоставляющий обработчики. Обработчики должны быть доступны базе: public
+/// или private с объявлением friend RsStaticHandler
+/// \tparam Interface интерфейс передачи, должен предоставлять write(const uint8_t *, size_t). Если интерфейс также
+/// предоставляет uint8_t *reserve(size_t aLength) и commit(size_t aLength), сообщения собираются прямо в выданной им
+/// области (слот DMA, кольцевой буфер) без промежуточного буфера. reserve может вернуть nullptr - тогда сообщение
+/// отправится через write. Если интерфейс предоставляет flush() (например, BufferedInterface), накопленные
+/// сообщения сбрасываются в конце update() и по явному вызову flush()
+/// \tparam Stats политика счетчиков канального уровня: LinkStats или NoLinkStats (счетчики не компилируются)
+/// \tparam Supported набор поддерживаемых сообщений (kMessages<...>). Остальные типы парсер отбрасывает на этапе
+/// заголовка, а их обработка в process() не компилируется
+/// \tparam Cache политика кэша ответов на повторы запросов: ResponseCache<Senders, FrameSize> или NoResponseCache
+/// (кэш не компилируется)
+template<class Derived, class Interface, typename Crc, size_t ParserSize, typename Stats = NoLinkStats,
+	MessageSet Supported = kAllMessages, typename Cache = NoResponseCache>
+class RsStaticHandler {
+	using Parser = RsParser<ParserSize, Crc, SupportedMessageLayout<Supported>, Stats>;
+
+	// Композит должен быть другом чтобы не нарушать инкапсуляцию
+	template<size_t, typename, typename...>
+	friend class MultiNode;
+
+public:
+	/// Кэш ответов включен - обработчику нужен весь трафик шины, см. ResponseCache
+	static constexpr bool kCachesResponses{!std::is_same_v<Cache, NoResponseCache>};
+
+	/// \brief Конструктор класса RsStaticHandler
+	/// \param aName имя устройства
+	/// \param aVersion версия устройства
+	/// \param aNodeUID номер данной ноды (от 0 до 255)
+	/// \param aInterface ссылка на экземпляр типа Interface, заданного шаблоном
+	RsStaticHandler(const char *aName, const DeviceVersion &aVersion, uint8_t aNodeUID, Interface &aInterface) :
+		name{aName},
+		version{aVersion},
+		health{Health::WarnUp},
+		flags{0},
+		nodeUID{aNodeUID},
+		parser{},
+		interface{aInterface},
+		messageBuffer{},
+		messageNumber{0},
+		responseCache{},
+		processing{nullptr},
+		busy{false},
+		probeFrame{ProbeMessage{{0, aNodeUID, MessageType::Probe, 0}, {0xFF}}},
+		healthReqFrame{HealthReqMessage{{0, aNodeUID, MessageType::HealthReq, 0}, {0x00}}},
+		deviceInfoReqFrame{DeviceInfoReqMessage{{0, aNodeUID, MessageType::DeviceInfoReq, 0}, {0x00}}}
+	{ }
+
+	uint8_t getUid() const
+	{
+		return nodeUID;
+	}
+
+	/// \brief Включить или выключить фильтр получателей парсера (по умолчанию выключен). С фильтром сообщения
+	/// другим нодам пропускаются без проверки CRC, если в них нет преамбулы - process() их все равно отбросит
+	/// \param aEnabled true - принимать только сообщения для этой ноды и широковещательные
+	void setReceiverFilter(bool aEnabled)
+	{
+		static_assert(!kCachesResponses, "ResponseCache must see frames for other nodes to expire its entries");
+
+		if (aEnabled) {
+			parser.setReceiverFilter(nodeUID);
+		} else {
+			parser.clearReceiverFilter();
+		}
+	}
+
+	/// \return Счетчики парсера и отправленных Ack, снимок через stats().snapshot() можно брать параллельно с приемом
+	const Stats &stats() const
+	{
+		return parser.stats();
+	}
+
+	/// \brief Основная функция, прокидывающая получаемые байты в парсер и отправляющие в протокольный обработчик
+	/// \param aData указатель на валидные данные
+	/// \param aLength размер валидных данных
+	void update(const uint8_t *aData, size_t aLength)
+	{
+		parser.parse(aData, aLength, [this](const uint8_t *aFrame, size_t aFrameLength) { process(aFrame, aFrameLength); });
+		// Ответы на все принятые сообщения уходят одной пачкой
+		flush();
+	}
+
+	/// \brief Отдать интерфейсу накопленные сообщения, если интерфейс буферизующий
+	void flush()
+	{
+		if constexpr (Detail::HasFlush<Interface>::value) {
+			interface.flush();
+		}
+	}
+
+	/// \brief Функция для отправки команды от текущей ноды
+	/// \param aReceiverUID UID получателя команды
+	/// \param aCommand номер команды
+	/// \param aArgument аргумент для команды (может быть незадействован)
+	/// \return номер сообщения
+	uint8_t sendCommand(uint8_t aReceiverUID, uint8_t aCommand, uint8_t aArgument)
+	{
+		ComMessage message;
+		message.messageType = MessageType::Command;
+		message.receiverUID = aReceiverUID;
+		message.transmitUID = nodeUID;
+		message.number = ++messageNumber;
+		message.payload.command = aCommand;
+		message.payload.value = aArgument;
+
+		send(message);
+		return message.number;
+	}
+
+	/// \brief Функция для отправки запроса на получение данных
+	/// \param aReceiverUID UID получателя запроса
+	/// \param aRequest номер запроса
+	/// \param aDataSize размер данных, которые данная нода будет ожидать в ответе
+	/// \return номер сообщения
+	uint8_t sendBlobRequest(uint8_t aReceiverUID, uint8_t aRequest, uint8_t aDataSize)
+	{
+		BlobReqMessage message;
+		message.messageType = MessageType::BlobRequest;
+		message.receiverUID = aReceiverUID;
+		message.transmitUID = nodeUID;
+		message.number = ++messageNumber;
+		message.payload.request = aRequest;
+		message.payload.answerDataSize = aDataSize;
+
+		send(message);
+		return message.number;
+	}
+
+	/// \brief Функция отправки запроса информации о устройстве
+	/// \param aReceiverUID UID получателя запроса
+	/// \return номер сообщения
+	uint8_t sendDeviceInfoRequest(uint8_t aReceiverUID)
+	{
+		const uint8_t number = ++messageNumber;
+		sendFrame(deviceInfoReqFrame, aReceiverUID, number);
+		return number;
+	}
+
+	/// \brief Отправка команды на перезагрузку устройства
+	/// \param aReceiverUID UID получателя
+	/// \param aMagic магическое число для управления
+	/// \return номер сообщения
+	uint8_t sendRebootCmd(uint8_t aReceiverUID, uint64_t aMagic)
+	{
+		RebootMessage message;
+		message.messageType = MessageType::Reboot;
+		message.receiverUID = aReceiverUID;
+		message.transmitUID = nodeUID;
+		message.payload.magic = aMagic;
+		message.number = ++messageNumber;
+
+		send(message);
+		return message.number;
+	}
+
+	/// \brief Запрос на отправку файла
+	/// \param aReceiverUID UID получателя
+	/// \param aFileNum номер файла
+	/// \param aFileSize размер отправляемого файла
+	/// \return номер сообщения
+	uint8_t fileWriteRequest(uint8_t aReceiverUID, uint8_t aFileNum, uint32_t aFileSize)
+	{
+		FileWriteRequestMessage message;
+		message.messageType = MessageType::FileWriteRequest;
+		message.receiverUID = aReceiverUID;
+		message.transmitUID = nodeUID;
+		message.number = ++messageNumber;
+		message.payload.fileNumber = aFileNum;
+		message.payload.fileSize = aFileSize;
+
+		send(message);
+		return message.number;
+	}
+
+	/// \brief Функция отправки чанка на устройство
+	/// \param aReceiverUID UID получателя
+	/// \param aFileNum номер файла
+	/// \param aChunk данные
+	/// \param aChunkSize размер чанка
+	/// \return номер сообщения
+	uint8_t fileWriteChunk(uint8_t aReceiverUID, uint8_t aFileNum, const void *aChunk, uint8_t aChunkSize)
+	{
+		const size_t fullSize = sizeof(FileWriteChunkMessage) + aChunkSize;
+		uint8_t *frame = beginFrame(fullSize);
+
+		// Заголовок и чанк пишутся сразу на место, без промежуточных копий
+		auto *message = reinterpret_cast<FileWriteChunkMessage *>(frame + 1);
+		message->messageType = MessageType::FileWriteChunk;
+		message->receiverUID = aReceiverUID;
+		message->transmitUID = nodeUID;
+		message->number = ++messageNumber;
+		message->payload.fileNum = aFileNum;
+		message->payload.chunkSize = aChunkSize;
+		memcpy(frame + 1 + sizeof(FileWriteChunkMessage), aChunk, aChunkSize);
+
+		const uint8_t number = message->number;
+		commitFrame(frame, fullSize);
+		return number;
+	}
+
+	/// \brief Отправить завершающую последовательность файла
+	/// \param aReceiverUID UID получателя
+ 	/// \param aFileNum номер файла
+	/// \param aChunkNumber общее число чанков
+	/// \param aCrc CRC64 от всех чанков
+	/// \return номер сообщения
+	uint8_t fileWriteFinalize(uint8_t aReceiverUID, uint8_t aFileNum, uint16_t aChunkNumber, uint64_t aCrc)
+	{
+		FileWriteFinalizeMessage message;
+		message.messageType = MessageType::FileWriteFinalize;
+		message.receiverUID = aReceiverUID;
+		message.transmitUID = nodeUID;
+		message.number = ++messageNumber;
+		message.payload.fileNum = aFileNum;
+		message.payload.chunksNumber = aChunkNumber;
+		message.payload.crc = aCrc;
+
+		send(message);
+		return message.number;
+	}
+
+	/// \brief Функция отправки Probe сообщения, целевая нода должна ответить, иначе она not present
+	/// \param aReceiverUID UID получателя ответа
+	/// \return номер сообщения
+	uint8_t sendProbe(uint8_t aReceiverUID)
+	{
+		const uint8_t number = ++messageNumber;
+		sendFrame(probeFrame, aReceiverUID, number);
+		return number;
+	}
+
+	/// \brief Запрос Health устройства
+	/// \param aReceiverUID
+	/// \return номер сообщения
+	uint8_t sendHealthRequest(uint8_t aReceiverUID)
+	{
+		const uint8_t number = ++messageNumber;
+		sendFrame(healthReqFrame, aReceiverUID, number);
+		return number;
+	}
+
+	/// \brief Завершить отложенную команду: отправить Ack с результатом.
+	/// complete* пишут в тот же буфер сообщения, интерфейс и кэш ответов, что и прием, поэтому вызываются в том же
+	/// контексте, что и update(): например, update() в основном цикле на байтах, которые прерывание складывает в
+	/// очередь, и complete* там же после медленной работы. Из обработчиков их не вызывают - если ответ готов сразу,
+	/// его просто возвращают. Одновременный вызов с приемом ловится assert в отладочной сборке
+	/// \param aPending запрос, полученный из defer()
+	/// \param aResult результат выполнения команды
+	void completeCommand(const PendingAnswer &aPending, Result aResult)
+	{
+		const Detail::ExclusiveSection section{busy};
+		responseCache.expect(aPending.transmitUID, aPending.number, aPending.type);
+		sendAck(aPending.transmitUID, aPending.number, aResult);
+		responseCache.disarm();
+		flush();
+	}
+
+	/// \brief Завершить отложенный запрос: отправить ответ с данными. Если данные не подходят под запрос,
+	/// отправляется Ack(InvalidArg). Контекст вызова - как у completeCommand
+	/// \param aPending запрос, полученный из defer()
+	/// \param aData данные ответа
+	/// \param aSize размер данных, должен совпадать с запрошенным
+	/// \return true, если ответ отправлен
+	bool completeBlobRequest(const PendingAnswer &aPending, const void *aData, uint8_t aSize)
+	{
+		const Detail::ExclusiveSection section{busy};
+		responseCache.expect(aPending.transmitUID, aPending.number, aPending.type);
+		const bool sent = sendAnswer(aPending.transmitUID, aPending.number, aPending.request, aPending.dataSize, aData, aSize);
+
+		if (!sent) {
+			sendAck(aPending.transmitUID, aPending.number, Result::InvalidArg);
+		}
+
+		responseCache.disarm();
+		flush();
+		return sent;
+	}
+
+	// Обработчики по умолчанию, наследник скрывает нужные своими с той же сигнатурой. Описание - в RsHandler
+	void handleDeviceHealth(uint8_t /*aTransmitUID*/, uint8_t /*aMessageNumber*/, Health /*aHealth*/, uint16_t /*aFlags*/) {}
+
+	Result processBlobRequest(uint8_t /*aTransmitUID*/, uint8_t /*aMessageNumber*/, uint8_t /*aRequest*/, uint8_t /*aRequestedDataSize*/)
+	{
+		return Result::Unsupported;
+	}
+
+	Result handleCommand(uint8_t /*aCommand*/, uint8_t /*aArgument*/)
+	{
+		return Result::Unsupported;
+	}
+
+	Result handleFileWriteRequest(uint8_t /*aTranceiverUID*/, uint8_t /*aFile*/, uint32_t /*aFileSize*/)
+	{
+		return Result::Unsupported;
+	}
+
+	Result handleWriteChunk(uint8_t /*aTransmitUID*/, uint8_t /*aFileNum*/, const void * /*aChunkData*/, size_t /*aChunkLen*/)
+	{
+		return Result::Unsupported;
+	}
+
+	Result handleWriteChunkFinalize(uint8_t /*aTransmitUID*/, uint8_t /*aFileNum*/, uint16_t /*aChunkCount*/, uint64_t /*aFileCRC*/)
+	{
+		return Result::Unsupported;
+	}
+
+	void handleDeviceInfoAnswer(uint8_t /*aTranceiverUID*/, uint8_t /*aMessageNumber*/, DeviceVersion /*aVersion*/, const void */*aName*/, size_t /*nameLen*/) {}
+
+	void handleAck(uint8_t /*aTranceiverUID*/, uint8_t /*aMessageNumber*/, Result /*aReturnCode*/) {}
+
+	Result handleReboot(uint64_t /*aMagic*/)
+	{
+		return Result::Unsupported;
+	}
+
+	Result handleBlobAnswer(uint8_t /*aTranceiverUID*/, uint8_t /*aMessageNumber*/, uint8_t /*aRequest*/, const uint8_t */*aData*/, uint8_t /*aLength*/)
+	{
+		return Result::Unsupported;
+	}
+
+protected:
+	/// \brief Функция, которая отправляет ответ, собранный в функции processRequest. Вызывать через базовый класс
+	/// \param aTranceiverUID UID отправителя ответа
+	/// \param aMessageNumber номер сообщения
+	/// \param aRequest номер запроса
+	/// \param aRequestedDataSize количество байт данных, которые были запрошены
+	/// \param aData указатель на данные для отправки
+	/// \param aSize размер данных для отправки
+	/// \return в случае ошибки возвращает false, иначе - true
+	bool sendAnswer(uint8_t aReceiverUID, uint8_t aMessageNumber, uint8_t aRequest, uint8_t aRequestedDataSize, const void *aData, uint8_t aSize)
+	{
+		if (aSize != aRequestedDataSize) {
+			return false;
+		}
+
+		if (aSize + 2 + sizeof(BlobAnwMessage) > ParserSize) {
+			return 0;
+		}
+
+		const size_t fullSize = sizeof(BlobAnwMessage) + aSize;
+		uint8_t *frame = beginFrame(fullSize);
+
+		auto *header = reinterpret_cast<BlobAnwMessage *>(frame + 1);
+		header->transmitUID = nodeUID;
+		header->receiverUID = aReceiverUID;
+		header->messageType = MessageType::BlobAnswer;
+		header->number = aMessageNumber;
+		header->payload.dataSize = aSize;
+		header->payload.request = aRequest;
+		header->payload.reserved = 0;
+		memcpy(frame + 1 + sizeof(BlobAnwMessage), aData, aSize);
+
+		commitFrame(frame, fullSize);
+		return true;
+	}
+
+	/// \brief Отложить ответ на обрабатываемый Command или BlobRequest. Вызывается из handleCommand или
+	/// processBlobRequest, которые затем возвращают Result::Wait: отправителю уходит Ack(Wait), чтобы он продлил
+	/// ожидание, а окончательный ответ отправляется позже через completeCommand или completeBlobRequest.
+	/// Из других обработчиков и вне update() вызывать нельзя - обрабатываемого запроса нет
+	/// \return запрос, который нужно передать в complete*
+	PendingAnswer defer() const
+	{
+		assert(processing != nullptr && "defer() is only valid inside handleCommand or processBlobRequest");
+		const auto *header = reinterpret_cast<const Header *>(processing);
+		PendingAnswer pending{header->transmitUID, header->number, header->messageType, 0, 0};
+
+		if (header->messageType == MessageType::BlobRequest) {
+			const auto *request = reinterpret_cast<const BlobReqMessage *>(processing);
+			pending.request = request->payload.request;
+			pending.dataSize = request->payload.answerDataSize;
+		}
+
+		return pending;
+	}
+
+	/// \brief Ответить на запрос заранее собранным сообщением из BlobSource, вызывать из processBlobRequest
+	/// через базовый класс. Данные не копируются и CRC не пересчитывается, подставляются получатель и номер
+	/// \param aReceiverUID UID получателя ответа
+	/// \param aMessageNumber номер сообщения
+	/// \param aRequestedDataSize количество байт данных, которые были запрошены
+	/// \param aSource источник данных
+	/// \return в случае ошибки возвращает false, иначе - true
+	template<size_t DataSize>
+	bool sendAnswer(uint8_t aReceiverUID, uint8_t aMessageNumber, uint8_t aRequestedDataSize,
+		const BlobSource<Crc, DataSize> &aSource)
+	{
+		static_assert(BlobSource<Crc, DataSize>::Template::size() <= ParserSize, "BlobSource answer does not fit ParserSize");
+
+		if (aSource.dataSize() != aRequestedDataSize) {
+			return false;
+		}
+
+		sendFrame(aSource.frame(), aReceiverUID, aMessageNumber);
+		return true;
+	}
+
+private:
+	const char *name;
+	const DeviceVersion version;
+
+	Health health;
+	uint16_t flags;
+
+	uint8_t nodeUID;
+	Parser parser;
+	Interface &interface;
+	uint8_t messageBuffer[ParserSize];
+	uint8_t messageNumber;
+	Cache responseCache;
+	const uint8_t *processing; // Обрабатываемый Command или BlobRequest, для defer(), вне обработчика - nullptr
+	std::atomic<bool> busy; // Идет прием или завершение отложенного ответа, см. Detail::ExclusiveSection
+
+	// Сообщения, в которых при отправке меняются только получатель и номер
+	FrameTemplate<Crc, ProbeMessage> probeFrame;
+	FrameTemplate<Crc, HealthReqMessage> healthReqFrame;
+	FrameTemplate<Crc, DeviceInfoReqMessage> deviceInfoReqFrame;
+
+	/// \return true, если тип сообщения входит в набор Supported
+	static constexpr bool supports(MessageType aType)
+	{
+		return (Supported & messageBit(aType)) != 0;
+	}
+
+	Derived &derived()
+	{
+		return static_cast<Derived &>(*this);
+	}
+
+	/// \brief Начать сообщение: выдает область под преамбулу, header+payload и CRC. Header+payload пишутся с frame + 1
+	/// \param aLength размер header+payload
+	/// \return начало сообщения - область интерфейса, если он ее выдал, иначе внутренний буфер
+	uint8_t *beginFrame(size_t aLength)
+	{
+		if constexpr (Detail::HasReserve<Interface>::value) {
+			uint8_t *frame = interface.reserve(aLength + 2);
+
+			if (frame != nullptr) {
+				return frame;
+			}
+		}
+
+		return messageBuffer;
+	}
+
+	/// \brief Завершить сообщение, начатое beginFrame: дописать преамбулу и CRC и отдать интерфейсу
+	/// \param aFrame начало сообщения из beginFrame
+	/// \param aLength размер header+payload
+	void commitFrame(uint8_t *aFrame, size_t aLength)
+	{
+		submitFrame(aFrame, Parser::seal(aFrame, aLength));
+	}
+
+	/// \brief Отдать интерфейсу готовое сообщение, собранное в области из beginFrame
+	/// \param aFrame начало сообщения из beginFrame
+	/// \param aLength полная длина сообщения
+	void submitFrame(uint8_t *aFrame, size_t aLength)
+	{
+		responseCache.capture(aFrame, aLength);
+
+		if constexpr (Detail::HasReserve<Interface>::value) {
+			if (aFrame != messageBuffer) {
+				interface.commit(aLength);
+				return;
+			}
+		}
+
+		interface.write(messageBuffer, aLength);
+	}
+
+	/// \brief Отправить сообщение из заготовки
+	/// \param aTemplate заготовка
+	/// \param aReceiverUID UID получателя
+	/// \param aNumber номер сообщения
+	template<typename Template>
+	void sendFrame(const Template &aTemplate, uint8_t aReceiverUID, uint8_t aNumber)
+	{
+		uint8_t *frame = beginFrame(Template::size() - 2);
+		submitFrame(frame, aTemplate.emit(frame, aReceiverUID, aNumber));
+	}
+
+	/// \brief Повторно отправить готовое сообщение из кэша ответов
+	/// \param aFrame сообщение с преамбулой и CRC
+	/// \param aLength полная длина сообщения
+	void replay(const uint8_t *aFrame, size_t aLength)
+	{
+		uint8_t *frame = beginFrame(aLength - 2);
+		memcpy(frame, aFrame, aLength);
+		submitFrame(frame, aLength);
+	}
+
+	/// \brief Отправить сообщение постоянного размера
+	/// \param aMessage сообщение
+	template<typename Message>
+	void send(const Message &aMessage)
+	{
+		uint8_t *frame = beginFrame(sizeof(aMessage));
+		memcpy(frame + 1, &aMessage, sizeof(aMessage));
+		commitFrame(frame, sizeof(aMessage));
+	}
+
+	/// \brief Функция отправки ответа
+	/// \param aTransmitterUID получатель ответа (отправитель команд\запросов)
+	/// \param aMessageNumber номер сообщения, такой же как у сообщения на который формируется ack
+	/// \param aReturnCode код возврата
+	void sendAck(uint8_t aTransmitterUID, uint8_t aMessageNumber, Result aReturnCode)
+	{
+		AckMessage message;
+		message.messageType = MessageType::Ack;
+		message.receiverUID = aTransmitterUID;
+		message.transmitUID = nodeUID;
+		message.number = aMessageNumber;
+		message.payload.code = aReturnCode;
+
+		send(message);
+		parser.stats().ackSent(aReturnCode);
+	}
+
+	/// \brief Запрос Health
+	/// \param aReceiverUID номер получателя
+	/// \param aMessageNumber номер сообщения
+	void sendHealth(uint8_t aReceiverUID, uint8_t aMessageNumber)
+	{
+		HealthAnwMessage message;
+		message.receiverUID = aReceiverUID;
+		message.transmitUID = nodeUID;
+		message.number = aMessageNumber;
+		message.messageType = MessageType::HealthAnw;
+
+		message.payload.health = health;
+		message.payload.flags = flags;
+
+		send(message);
+	}
+
+	/// \brief Обработка запроса получения версии
+	/// \param aReceiverUID UID получателя
+	/// \param aMessageNumber
+	void processDeviceInfoRequest(uint8_t aReceiverUID, uint8_t aMessageNumber)
+	{
+		const size_t nameLen = strlen(name);
+		const size_t fullSize = sizeof(DeviceInfoAnwMessage) + nameLen;
+		uint8_t *frame = beginFrame(fullSize);
+
+		auto *message = reinterpret_cast<DeviceInfoAnwMessage *>(frame + 1);
+		message->messageType = MessageType::DeviceInfoAnw;
+		message->transmitUID = nodeUID;
+		message->receiverUID = aReceiverUID;
+		message->number = aMessageNumber;
+		message->payload.version = version;
+		message->payload.nameLen = nameLen;
+		memcpy(frame + 1 + sizeof(DeviceInfoAnwMessage), name, nameLen);
+
+		commitFrame(frame, fullSize);
+	}
+
+	/// \brief Основная функция для взаимодействия внутри протокола, обработка идет только если сообщение предназначено
+	/// именно этой ноде
+	/// \param aMessage указатель на распаршенное сообщение
+	/// \param aLength длина сообщения (пока не
+	/// зайдествована)
+	void process(const uint8_t *aMessage, size_t aLength)
+	{
+		if (aLength < sizeof(Header)) {
+			return;
+		}
+
+		const auto *header = reinterpret_cast<const Header *>(aMessage);
+		const bool broadcast = header->receiverUID == kReservedUID;
+		const Detail::ExclusiveSection section{busy};
+
+		if (header->receiverUID == nodeUID || broadcast) {
+			// Повтор запроса, ответ на который уже отправлялся, - обработчик не вызывается
+			size_t cachedLength{0};
+			const uint8_t *cached = responseCache.find(header->transmitUID, header->number, header->messageType, cachedLength);
+
+			if (cached != nullptr) {
+				replay(cached, cachedLength);
+				return;
+			}
+
+			bool ackNeeded = true;
+			Result ackCode{Result::Unsupported};
+
+			switch (header->messageType) {
+				case MessageType::Ack: {
+					if constexpr (supports(MessageType::Ack)) {
+						const auto ackMsg = reinterpret_cast<const AckMessage *>(aMessage);
+						derived().handleAck(header->transmitUID, header->number, static_cast<Result>(ackMsg->payload.code));
+					}
+					ackNeeded = false; // ACK на ACK не нужен
+				} break;
+
+				case MessageType::BlobAnswer: {
+					if constexpr (supports(MessageType::BlobAnswer)) {
+						const auto answerMsg = reinterpret_cast<const BlobAnwMessage *>(aMessage);
+						ackCode = derived().handleBlobAnswer(header->transmitUID, header->number, answerMsg->payload.request,
+							&aMessage[sizeof(BlobAnwMessage)], answerMsg->payload.dataSize);
+					}
+				} break;
+
+				case MessageType::Command: {
+					if constexpr (supports(MessageType::Command)) {
+						const auto cmdMsg = reinterpret_cast<const ComMessage *>(aMessage);
+						processing = aMessage;
+						ackCode = derived().handleCommand(cmdMsg->payload.command, cmdMsg->payload.value);
+					}
+				} break;
+
+				case MessageType::BlobRequest: {
+					if constexpr (supports(MessageType::BlobRequest)) {
+						const auto reqMsg = reinterpret_cast<const BlobReqMessage *>(aMessage);
+						processing = aMessage;
+						ackCode = derived().processBlobRequest(reqMsg->transmitUID, reqMsg->number, reqMsg->payload.request, reqMsg->payload.answerDataSize);
+						if (ackCode == Result::Ok) {
+							ackNeeded = false; // Если ответ отправлен - дальше ACK не отправляем
+						}
+					}
+				} break;
+
+				case MessageType::Probe: {
+					if constexpr (supports(MessageType::Probe)) {
+						ackCode = Result::Ok;
+					}
+				} break;
+
+				case MessageType::Reboot: {
+					if constexpr (supports(MessageType::Reboot)) {
+						const auto rebootMsg = reinterpret_cast<const RebootMessage *>(aMessage);
+						ackCode = derived().handleReboot(rebootMsg->payload.magic);
+					}
+				} break;
+
+				case MessageType::DeviceInfoReq: {
+					if constexpr (supports(MessageType::DeviceInfoReq)) {
+						processDeviceInfoRequest(header->transmitUID, header->number);
+						ackNeeded = false; // После ответа с ПО не нужен ACK
+					}
+				} break;
+
+				case MessageType::DeviceInfoAnw: {
+					if constexpr (supports(MessageType::DeviceInfoAnw)) {
+						const auto deviceInfo = reinterpret_cast<const DeviceInfoAnwMessage *>(aMessage);
+						derived().handleDeviceInfoAnswer(header->transmitUID, header->number, deviceInfo->payload.version,
+						&aMessage[sizeof(DeviceInfoAnwMessage)], deviceInfo->payload.nameLen);
+						ackCode = Result::Ok;
+					}
+				} break;
+
+				case MessageType::FileWriteRequest: {
+					if constexpr (supports(MessageType::FileWriteRequest)) {
+						const auto fileWReq = reinterpret_cast<const FileWriteRequestMessage *>(aMessage);
+						ackCode = derived().handleFileWriteRequest(header->transmitUID, fileWReq->payload.fileNumber, fileWReq->payload.fileSize);
+					}
+				} break;
+
+				case MessageType::FileWriteChunk: {
+					if constexpr (supports(MessageType::FileWriteChunk)) {
+						const auto chunk = reinterpret_cast<const FileWriteChunkMessage *>(aMessage);
+						ackCode = derived().handleWriteChunk(header->transmitUID, chunk->payload.fileNum, &aMessage[sizeof(FileWriteChunkMessage)], chunk->payload.chunkSize);
+					}
+				} break;
+
+				case MessageType::FileWriteFinalize: {
+					if constexpr (supports(MessageType::FileWriteFinalize)) {
+						const auto chunkFinal = reinterpret_cast<const FileWriteFinalizeMessage *>(aMessage);
+						ackCode = derived().handleWriteChunkFinalize(header->transmitUID, chunkFinal->payload.fileNum, chunkFinal->payload.chunksNumber, chunkFinal->payload.crc);
+					}
+				} break;
+
+				case MessageType::HealthReq: {
+					if constexpr (supports(MessageType::HealthReq)) {
+						sendHealth(header->transmitUID, header->number);
+						ackNeeded = false;
+					}
+				} break;
+
+				case MessageType::HealthAnw: {
+					if constexpr (supports(MessageType::HealthAnw)) {
+						const auto healthMes = reinterpret_cast<const HealthAnwMessage *>(aMessage);
+						derived().handleDeviceHealth(header->transmitUID, header->number, healthMes->payload.health, healthMes->payload.flags);
+						ackCode = Result::Ok;
+					}
+				} break;
+
+				default:
+					break;
+			}
+
+			// Сообщение лежит в буфере парсера, после обработки defer() его видеть не должен
+			processing = nullptr;
+
+			if (ackNeeded) {
+				sendAck(header->transmitUID, header->number, ackCode);
+			}
+
+			responseCache.disarm();
+		} else {
+			// Сообщения другим нодам двигают счетчик номеров отправителя
+			responseCache.overheard(header->transmitUID);
+		}
+	}
+};
+
+} // namespace RS
+#endif // LIB_RSSTATICHANDLER_HPP
@@ -0,0 +1,162 @@
+/*!
+\file
+\brief Счетчики канального уровня для парсера и обработчика UtilitaryRS
+\author V-Nezlo (vlladimirka@gmail.com)
+\date 16.10.2026
+\version 1.0
+
+Счетчики парсера пишет поток приема, а счетчик отправленных Ack - и поток, завершающий отложенные ответы
+(RsStaticHandler::completeCommand), поэтому инкремент - relaxed fetch_add. Порядок между счетчиками не нужен,
+снимок можно читать из любого потока, не останавливая прием
+*/
+
+#ifndef LIB_RSSTATS_HPP
+#define LIB_RSSTATS_HPP
+
+#include "RsTypes.hpp"
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace RS {
+
+/// \brief Снимок счетчиков
+struct LinkStatsSnapshot {
+	/// Число счетчиков по типам: стандартные типы и последний - все пользовательские
+	static constexpr size_t kTypes{static_cast<size_t>(MessageType::TypeEnd) + 1};
+	/// Число счетчиков по кодам возврата: стандартные коды и последний - все пользовательские
+	static constexpr size_t kResults{static_cast<size_t>(Result::ChecksumFailed) + 2};
+
+	/// Принято байт
+	uint32_t bytesReceived;
+	/// Байт, отброшенных в ожидании преамбулы (повторно просмотренные после ложной преамбулы учитываются снова)
+	uint32_t bytesDiscarded;
+	/// Сообщений, отброшенных из-за неизвестного типа
+	uint32_t headerRejects;
+	/// Сообщений, отброшенных из-за превышения размера буфера или максимальной длины хвоста
+	uint32_t oversizeRejects;
+	/// Сообщений с несошедшимся CRC
+	uint32_t crcFailures;
+	/// Сообщений другим нодам, пропущенных фильтром получателей
+	uint32_t foreignFrames;
+	/// Принятых сообщений по типам
+	uint32_t framesAccepted[kTypes];
+	/// Отправленных Ack по кодам возврата
+	uint32_t acksSent[kResults];
+};
+
+/// \brief Политика со счетчиками
+class LinkStats {
+public:
+	void received(size_t aLength)
+	{
+		add(counters.bytesReceived, aLength);
+	}
+
+	void discarded(size_t aLength)
+	{
+		add(counters.bytesDiscarded, aLength);
+	}
+
+	void headerReject()
+	{
+		add(counters.headerRejects, 1);
+	}
+
+	void oversizeReject()
+	{
+		add(counters.oversizeRejects, 1);
+	}
+
+	void crcFailure()
+	{
+		add(counters.crcFailures, 1);
+	}
+
+	void foreign()
+	{
+		add(counters.foreignFrames, 1);
+	}
+
+	void accepted(MessageType aType)
+	{
+		const size_t index = static_cast<size_t>(aType);
+		add(counters.framesAccepted[index < LinkStatsSnapshot::kTypes ? index : LinkStatsSnapshot::kTypes - 1], 1);
+	}
+
+	void ackSent(Result aResult)
+	{
+		const size_t index = static_cast<size_t>(aResult);
+		add(counters.acksSent[index < LinkStatsSnapshot::kResults ? index : LinkStatsSnapshot::kResults - 1], 1);
+	}
+
+	/// \brief Получить снимок счетчиков, можно вызывать параллельно с приемом
+	/// \return снимок, каждый счетчик прочитан атомарно, но не все вместе
+	LinkStatsSnapshot snapshot() const
+	{
+		LinkStatsSnapshot result{};
+
+		result.bytesReceived = load(counters.bytesReceived);
+		result.bytesDiscarded = load(counters.bytesDiscarded);
+		result.headerRejects = load(counters.headerRejects);
+		result.oversizeRejects = load(counters.oversizeRejects);
+		result.crcFailures = load(counters.crcFailures);
+		result.foreignFrames = load(counters.foreignFrames);
+
+		for (size_t i = 0; i < LinkStatsSnapshot::kTypes; ++i) {
+			result.framesAccepted[i] = load(counters.framesAccepted[i]);
+		}
+		for (size_t i = 0; i < LinkStatsSnapshot::kResults; ++i) {
+			result.acksSent[i] = load(counters.acksSent[i]);
+		}
+
+		return result;
+	}
+
+private:
+	using Counter = std::atomic<uint32_t>;
+
+	struct Counters {
+		Counter bytesReceived{};
+		Counter bytesDiscarded{};
+		Counter headerRejects{};
+		Counter oversizeRejects{};
+		Counter crcFailures{};
+		Counter foreignFrames{};
+		Counter framesAccepted[LinkStatsSnapshot::kTypes]{};
+		Counter acksSent[LinkStatsSnapshot::kResults]{};
+	} counters;
+
+	static void add(Counter &aCounter, size_t aValue)
+	{
+		aCounter.fetch_add(static_cast<uint32_t>(aValue), std::memory_order_relaxed);
+	}
+
+	static uint32_t load(const Counter &aCounter)
+	{
+		return aCounter.load(std::memory_order_relaxed);
+	}
+};
+
+/// \brief Политика без счетчиков, все вызовы пустые и вырезаются компилятором
+class NoLinkStats {
+public:
+	void received(size_t) {}
+	void discarded(size_t) {}
+	void headerReject() {}
+	void oversizeReject() {}
+	void crcFailure() {}
+	void foreign() {}
+	void accepted(MessageType) {}
+	void ackSent(Result) {}
+
+	LinkStatsSnapshot snapshot() const
+	{
+		return LinkStatsSnapshot{};
+	}
+};
+
+} // namespace RS
+
+#endif // LIB_RSSTATS_HPP
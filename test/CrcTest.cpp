@@ -0,0 +1,153 @@
+#include <UtilitaryRS/Crc64.hpp>
+#include <UtilitaryRS/Crc64Legacy.hpp>
+#include <UtilitaryRS/Crc64Parallel.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// NOLINTBEGIN
+uint64_t crc64Reference(const uint8_t *aData, size_t aLength, uint64_t aChecksum = 0)
+{
+	for (size_t i = 0; i < aLength; ++i) { aChecksum = Crc64::updateBitwise(aChecksum, aData[i]); }
+	return aChecksum;
+}
+
+bool crc64CheckValue()
+{
+	const char check[] = "123456789";
+	const bool success = Crc64::calculate(check, 9) == 0x4DB9A9F87EC10C59ULL
+		&& Crc64::calculate(check, 9) == crc64Reference(reinterpret_cast<const uint8_t *>(check), 9);
+
+	std::cout << (success ? "Crc64 check value matches" : "Crc64 check value differs") << std::endl;
+	return success;
+}
+
+bool crc64SlicesMatchReference()
+{
+	std::mt19937 rng{3};
+	std::vector<uint8_t> data(4096 + 64);
+	for (auto &byte : data) { byte = static_cast<uint8_t>(rng()); }
+
+	std::uniform_int_distribution<size_t> offset{0, 63};
+	std::uniform_int_distribution<size_t> length{0, 4096};
+	bool success = true;
+
+	for (size_t i = 0; i < 2000 && success; ++i) {
+		// Случайные длины и выравнивания, плюс продолжение с ненулевой суммы
+		const size_t start = offset(rng);
+		const size_t size = i < 64 ? i : length(rng);
+		const uint64_t init = i % 2 ? 0 : (static_cast<uint64_t>(rng()) << 32 | rng());
+		const uint64_t reference = crc64Reference(data.data() + start, size, init);
+
+		success &= Crc64::updateBytes(init, data.data() + start, size) == reference;
+		success &= Crc64::updateSlice8(init, data.data() + start, size) == reference;
+		success &= Crc64::updateSlice16(init, data.data() + start, size) == reference;
+		success &= Crc64::update(init, data.data() + start, size) == reference;
+
+		// Расчет по частям совпадает с расчетом целиком
+		const size_t split = size / 3;
+		success &= Crc64::update(Crc64::update(init, data.data() + start, split), data.data() + start + split, size - split)
+			== reference;
+	}
+
+	std::cout << (success ? "Crc64 slices match reference" : "Crc64 slices differ from reference") << std::endl;
+	return success;
+}
+
+bool crc64ClmulMatchesReference()
+{
+	if (!Crc64::hasClmul()) {
+		std::cout << "Crc64 carry-less multiply is not available, dispatch falls back to tables" << std::endl;
+		return Crc64::update(0, "123456789", 9) == 0x4DB9A9F87EC10C59ULL;
+	}
+
+	std::mt19937 rng{5};
+	std::vector<uint8_t> data(16384 + 64);
+	for (auto &byte : data) { byte = static_cast<uint8_t>(rng()); }
+
+	std::uniform_int_distribution<size_t> offset{0, 63};
+	std::uniform_int_distribution<size_t> length{0, 16384};
+	bool success = true;
+
+	for (size_t i = 0; i < 1000 && success; ++i) {
+		// Сначала все длины вокруг границ блоков 16 и 64 байта, затем случайные
+		const size_t start = offset(rng);
+		const size_t size = i < 256 ? i : length(rng);
+		const uint64_t init = i % 2 ? 0 : (static_cast<uint64_t>(rng()) << 32 | rng());
+		const uint64_t reference = crc64Reference(data.data() + start, size, init);
+
+		success &= Crc64::updateClmul(init, data.data() + start, size) == reference;
+		success &= Crc64::update(init, data.data() + start, size) == reference;
+	}
+
+	std::cout << (success ? "Crc64 carry-less multiply matches reference" : "Crc64 carry-less multiply differs from reference")
+			  << std::endl;
+	return success;
+}
+
+bool crc64CombineMatchesWhole()
+{
+	std::mt19937 rng{9};
+	std::vector<uint8_t> data(1 << 20);
+	for (auto &byte : data) { byte = static_cast<uint8_t>(rng()); }
+
+	const uint64_t whole = Crc64::calculate(data.data(), data.size());
+	std::uniform_int_distribution<size_t> split{0, data.size()};
+	bool success = Crc64::combine(whole, 0, 0) == whole;
+
+	for (size_t i = 0; i < 100 && success; ++i) {
+		const size_t first = i < 2 ? i * data.size() : split(rng);
+		success &= Crc64::combine(Crc64::calculate(data.data(), first), Crc64::calculate(data.data() + first,
+			data.size() - first), data.size() - first) == whole;
+	}
+
+	// Части на потоках, включая остаток от деления на число потоков
+	for (size_t threads = 1; threads <= 7 && success; ++threads) {
+		success &= Crc64Parallel::calculate(data.data(), data.size() - threads, threads, 4096)
+			== Crc64::calculate(data.data(), data.size() - threads);
+	}
+
+	success &= Crc64Parallel::calculate(data.data(), 100, 4, 4096) == Crc64::calculate(data.data(), 100);
+
+	std::cout << (success ? "Crc64 combine matches whole buffer" : "Crc64 combine differs from whole buffer") << std::endl;
+	return success;
+}
+
+/// \brief Crc64Legacy дает те же значения, что Crc64::calculate до перехода на slice-by-16, в том числе по частям
+bool crc64LegacyMatchesPreviousRelease()
+{
+	const char check[] = "123456789";
+	uint8_t image[1000];
+	for (size_t i = 0; i < sizeof(image); ++i) { image[i] = static_cast<uint8_t>(i); }
+
+	// Значения посчитаны прежней реализацией Crc64::calculate
+	bool success = Crc64Legacy::calculate(check, 9) == 0xA03C89C27A892762ULL;
+	success &= Crc64Legacy::calculate(image, sizeof(image)) == 0xC8475082FA5FFA75ULL;
+
+	uint64_t running = Crc64Legacy::kInitChecksum;
+	for (size_t offset = 0; offset < sizeof(image); offset += 48) {
+		running = Crc64Legacy::update(running, image + offset, std::min<size_t>(48, sizeof(image) - offset));
+	}
+	success &= running == Crc64Legacy::calculate(image, sizeof(image));
+
+	std::cout << (success ? "Crc64Legacy matches previous release" : "Crc64Legacy differs from previous release")
+			  << std::endl;
+	return success;
+}
+
+int main()
+{
+	bool success = true;
+
+	success &= crc64CheckValue();
+	success &= crc64SlicesMatchReference();
+	success &= crc64ClmulMatchesReference();
+	success &= crc64CombineMatchesWhole();
+	success &= crc64LegacyMatchesPreviousRelease();
+
+	return success ? 0 : 1;
+}
+// NOLINTEND
@@ -1,5 +1,7 @@
 
 #include "Mocks/MockSerial.hpp"
+#include <UtilitaryRS/BufferedInterface.hpp>
+#include <UtilitaryRS/FrameTemplate.hpp>
 #include <UtilitaryRS/RsHandler.hpp>
 #include <UtilitaryRS/RsTypes.hpp>
 #include <UtilitaryRS/Crc8.hpp>
@@ -100,6 +102,109 @@ private:
 	} context;
 };
 
+/// \brief Обработчик без виртуальных вызовов, реализует только команды
+template<class Interface>
+class StaticHandler : public RS::RsStaticHandler<StaticHandler<Interface>, Interface, Crc8, 100> {
+	using BaseType = RS::RsStaticHandler<StaticHandler<Interface>, Interface, Crc8, 100>;
+	friend BaseType;
+
+public:
+	using BaseType::BaseType;
+
+private:
+	RS::Result handleCommand(uint8_t aCommand, uint8_t aArgument)
+	{
+		return aCommand == 0x06 && aArgument == 0x07 ? RS::Ok : RS::InvalidArg;
+	}
+};
+
+/// \brief Минимальный слейв: только Probe, Command и HealthReq, остальные типы даже не разбираются
+using MinimalBase = RS::RsStaticHandler<class MinimalHandler, MockSerial, Crc8, 100, RS::NoLinkStats,
+	RS::kMessages<RS::MessageType::Probe, RS::MessageType::Command, RS::MessageType::HealthReq>>;
+
+class MinimalHandler : public MinimalBase {
+public:
+	using MinimalBase::MinimalBase;
+
+	RS::Result handleCommand(uint8_t, uint8_t)
+	{
+		return RS::Ok;
+	}
+};
+
+/// \brief Слейв с кэшем ответов, считает вызовы обработчика команд
+class CachedHandler : public RS::RsStaticHandler<CachedHandler, MockSerial, Crc8, 100, RS::NoLinkStats, RS::kAllMessages,
+	RS::ResponseCache<2, 16>> {
+public:
+	using RsStaticHandler::RsStaticHandler;
+
+	RS::Result handleCommand(uint8_t, uint8_t)
+	{
+		++commands;
+		return RS::Ok;
+	}
+
+	size_t commands{0};
+};
+
+/// \brief Слейв, отвечающий на запрос 2 из копии данных (sendAnswer) или из заготовки (BlobSource)
+template<bool UseSource>
+class SensorHandler : public RS::RsStaticHandler<SensorHandler<UseSource>, MockSerial, Crc8, 100> {
+	using BaseType = RS::RsStaticHandler<SensorHandler<UseSource>, MockSerial, Crc8, 100>;
+
+public:
+	SensorHandler(const RS::DeviceVersion &aVersion, MockSerial &aSerial) :
+		BaseType("TestHandler", aVersion, 0xFF, aSerial),
+		source{0xFF, 0x02},
+		value{0}
+	{ }
+
+	void publish(uint32_t aValue)
+	{
+		value = aValue;
+		source.publish(&value);
+	}
+
+	RS::Result processBlobRequest(uint8_t aTransmitUID, uint8_t aMessageNumber, uint8_t aRequest, uint8_t aRequestedDataSize)
+	{
+		if (aRequest != source.request()) {
+			return RS::Unsupported;
+		}
+
+		if constexpr (UseSource) {
+			return BaseType::sendAnswer(aTransmitUID, aMessageNumber, aRequestedDataSize, source) ? RS::Ok : RS::InvalidArg;
+		} else {
+			return BaseType::sendAnswer(aTransmitUID, aMessageNumber, aRequest, aRequestedDataSize, &value, sizeof(value))
+				? RS::Ok : RS::InvalidArg;
+		}
+	}
+
+private:
+	RS::BlobSource<Crc8, sizeof(uint32_t)> source;
+	uint32_t value;
+};
+
+/// \brief Слейв с медленными командами и запросами: ответ откладывается и отправляется вне update()
+class DeferredHandler : public RS::RsStaticHandler<DeferredHandler, MockSerial, Crc8, 100> {
+public:
+	using RsStaticHandler::RsStaticHandler;
+
+	RS::Result handleCommand(uint8_t, uint8_t)
+	{
+		command = defer();
+		return RS::Wait;
+	}
+
+	RS::Result processBlobRequest(uint8_t, uint8_t, uint8_t, uint8_t)
+	{
+		request = defer();
+		return RS::Wait;
+	}
+
+	RS::PendingAnswer command{};
+	RS::PendingAnswer request{};
+};
+
 int main()
 {
 	bool commandAckReceived = false;
@@ -185,7 +290,165 @@ int main()
 	handler.update(rebootMsg, sizeof(rebootMsg));
 	const uint8_t expectedRebootAck[] = {0x52, 0x1, 0xff, 0x1, 0x0, 0x2, 0x31};
 
-	return 0;
+	// Сообщения, собранные по месту в слоте интерфейса, должны совпадать с собранными через write
+	MockDmaSerial dma;
+	MasterHandler<MockDmaSerial, Crc8, 100> dmaHandler("TestHandler", version, 0xFF, dma);
+	MasterHandler<MockSerial, Crc8, 100> copyHandler("TestHandler", version, 0xFF, serial);
+	const uint8_t chunk[] = {0x52, 0x01, 0x02, 0x03, 0x04};
+	const uint8_t bigChunk[80] = {};
+	serial.clear();
+
+	copyHandler.fileWriteChunk(0x01, 0x01, chunk, sizeof(chunk));
+	copyHandler.sendProbe(0x01);
+	copyHandler.update(deviceInfoReq, sizeof(deviceInfoReq));
+	copyHandler.fileWriteChunk(0x01, 0x01, bigChunk, sizeof(bigChunk));
+	dmaHandler.fileWriteChunk(0x01, 0x01, chunk, sizeof(chunk));
+	dmaHandler.sendProbe(0x01);
+	dmaHandler.update(deviceInfoReq, sizeof(deviceInfoReq));
+	// Не помещается в слот - уходит через write
+	dmaHandler.fileWriteChunk(0x01, 0x01, bigChunk, sizeof(bigChunk));
+
+	const bool sealedFramesMatch = dma.size() == serial.size() && !memcmp(dma.data(), serial.data(), serial.size())
+		&& dma.commits == 3 && dma.writes == 1;
+	std::cout << (sealedFramesMatch ? "Frames sealed in place" : "Frames sealed in place differ") << std::endl;
+
+	// Ответы на все сообщения из одного update уходят одной записью
+	MockDmaSerial batched;
+	RS::BufferedInterface<MockDmaSerial, 256> buffered{batched};
+	MasterHandler<RS::BufferedInterface<MockDmaSerial, 256>, Crc8, 100> bufferedHandler("TestHandler", version, 0xFF, buffered);
+	uint8_t twoCommands[sizeof(commandMessage) * 2];
+	memcpy(twoCommands, commandMessage, sizeof(commandMessage));
+	memcpy(twoCommands + sizeof(commandMessage), commandMessage, sizeof(commandMessage));
+	bufferedHandler.update(twoCommands, sizeof(twoCommands));
+
+	const bool acksBatched = batched.writes == 1 && buffered.pending() == 0 && batched.size() == 2 * sizeof(expectedCmdAck)
+		&& !memcmp(batched.data(), batched.data() + sizeof(expectedCmdAck), sizeof(expectedCmdAck));
+	std::cout << (acksBatched ? "Acks batched" : "Acks not batched") << std::endl;
+
+	// Заготовка с подмененными получателем и номером совпадает с сообщением, собранным целиком
+	RS::FrameTemplate<Crc8, RS::HealthReqMessage> healthFrame{RS::HealthReqMessage{{0, 0x42, RS::MessageType::HealthReq, 0}, {0x00}}};
+	bool templatesMatch = true;
+
+	for (unsigned receiver = 0; receiver < 256; ++receiver) {
+		for (unsigned number = 0; number < 256; ++number) {
+			const RS::HealthReqMessage message{{static_cast<uint8_t>(receiver), 0x42, RS::MessageType::HealthReq,
+				static_cast<uint8_t>(number)}, {0x00}};
+			uint8_t expected[sizeof(message) + 2];
+			memcpy(expected + 1, &message, sizeof(message));
+			RS::RsParser<16, Crc8>::seal(expected, sizeof(message));
+
+			uint8_t emitted[sizeof(expected)];
+			templatesMatch &= healthFrame.emit(emitted, static_cast<uint8_t>(receiver), static_cast<uint8_t>(number))
+					== sizeof(expected)
+				&& !memcmp(emitted, expected, sizeof(expected));
+		}
+	}
+
+	std::cout << (templatesMatch ? "Frame templates match" : "Frame templates differ") << std::endl;
+
+	// Статическая диспетчеризация отвечает так же, как виртуальная, а без обработчика - Unsupported
+	serial.clear();
+	StaticHandler<MockSerial> staticHandler("TestHandler", version, 0xFF, serial);
+	staticHandler.update(commandMessage, sizeof(commandMessage));
+	const bool staticCommandAck = serial.size() == sizeof(expectedCmdAck) && serial.data()[5] == RS::Ok;
+	serial.clear();
+	staticHandler.update(rebootMsg, sizeof(rebootMsg));
+	const bool staticDispatch = staticCommandAck && serial.size() == sizeof(expectedRebootAck)
+		&& serial.data()[5] == RS::Unsupported;
+	std::cout << (staticDispatch ? "Static dispatch" : "Static dispatch failed") << std::endl;
+
+	// Неподдерживаемые типы отбрасываются парсером, ответа на них нет
+	serial.clear();
+	MinimalHandler minimal("TestHandler", version, 0xFF, serial);
+	minimal.update(rebootMsg, sizeof(rebootMsg));
+	minimal.update(blobReq, sizeof(blobReq));
+	const bool unsupportedDropped = serial.size() == 0;
+	minimal.update(commandMessage, sizeof(commandMessage));
+	minimal.update(healthReq, sizeof(healthReq));
+	const bool messageSet = unsupportedDropped && serial.size() == sizeof(expectedCmdAck) + sizeof(healthAnw);
+	std::cout << (messageSet ? "Message set respected" : "Message set ignored") << std::endl;
+
+	// Повтор команды получает тот же Ack из кэша, обработчик второй раз не вызывается
+	serial.clear();
+	CachedHandler cached("TestHandler", version, 0xFF, serial);
+	cached.update(commandMessage, sizeof(commandMessage));
+	cached.update(commandMessage, sizeof(commandMessage));
+	const bool ackReplayed = cached.commands == 1 && serial.size() == 2 * sizeof(expectedCmdAck)
+		&& serial.data()[5] == RS::Ok && !memcmp(serial.data(), serial.data() + sizeof(expectedCmdAck), sizeof(expectedCmdAck));
+
+	// Другое сообщение от того же отправителя вытесняет запись: старый номер снова обрабатывается
+	RS::ComMessage nextCommand{{0xFF, 0xAB, RS::MessageType::Command, 0x02}, {0x06, 0x07, 0x08}};
+	uint8_t nextFrame[sizeof(nextCommand) + 2];
+	memcpy(nextFrame + 1, &nextCommand, sizeof(nextCommand));
+	RS::RsParser<16, Crc8>::seal(nextFrame, sizeof(nextCommand));
+	cached.update(nextFrame, sizeof(nextFrame));
+	cached.update(commandMessage, sizeof(commandMessage));
+	const bool numberReused = cached.commands == 3;
+
+	// Сообщения того же отправителя другой ноде: несколько не мешают повтору, а после 256 номер мог вернуться
+	// по кругу, и совпавший номер - уже новый запрос
+	RS::ComMessage otherCommand{{0x05, 0xAB, RS::MessageType::Command, 0x00}, {0x06, 0x07, 0x08}};
+	uint8_t otherFrame[sizeof(otherCommand) + 2];
+	const auto overhear = [&](size_t aFrames) {
+		for (size_t i = 0; i < aFrames; ++i) {
+			otherCommand.number = static_cast<uint8_t>(otherCommand.number + 1);
+			memcpy(otherFrame + 1, &otherCommand, sizeof(otherCommand));
+			RS::RsParser<16, Crc8>::seal(otherFrame, sizeof(otherCommand));
+			cached.update(otherFrame, sizeof(otherFrame));
+		}
+	};
+
+	overhear(3);
+	cached.update(commandMessage, sizeof(commandMessage));
+	const bool replayedAfterOthers = cached.commands == 3;
+	overhear(256);
+	cached.update(commandMessage, sizeof(commandMessage));
+	const bool responseCache = ackReplayed && numberReused && replayedAfterOthers && cached.commands == 4;
+	std::cout << (responseCache ? "Responses replayed from cache" : "Response cache failed") << std::endl;
+
+	// Ответ из заготовки совпадает с собранным sendAnswer, в том числе после публикации новых данных
+	MockSerial copySerial;
+	MockSerial sourceSerial;
+	SensorHandler<false> copySensor(version, copySerial);
+	SensorHandler<true> sourceSensor(version, sourceSerial);
+
+	RS::BlobReqMessage sensorRequest{{0xFF, 0x01, RS::MessageType::BlobRequest, 0x05}, {0x02, sizeof(uint32_t)}};
+	uint8_t sensorFrame[sizeof(sensorRequest) + 2];
+	memcpy(sensorFrame + 1, &sensorRequest, sizeof(sensorRequest));
+	RS::RsParser<16, Crc8>::seal(sensorFrame, sizeof(sensorRequest));
+
+	for (uint32_t value : {0u, 0xAABBCCDDu, 0x12345678u}) {
+		copySensor.publish(value);
+		sourceSensor.publish(value);
+		copySensor.update(sensorFrame, sizeof(sensorFrame));
+		sourceSensor.update(sensorFrame, sizeof(sensorFrame));
+	}
+
+	const bool blobSource = copySerial.size() == 3 * (sizeof(RS::BlobAnwMessage) + sizeof(uint32_t) + 2)
+		&& sourceSerial.size() == copySerial.size() && !memcmp(sourceSerial.data(), copySerial.data(), copySerial.size());
+	std::cout << (blobSource ? "Blob source answers match" : "Blob source answers differ") << std::endl;
+
+	// Отложенные ответы: сразу Ack(Wait), окончательный ответ с тем же номером - после complete*
+	serial.clear();
+	DeferredHandler deferred("TestHandler", version, 0xFF, serial);
+	deferred.update(commandMessage, sizeof(commandMessage));
+	deferred.update(sensorFrame, sizeof(sensorFrame));
+	const bool waitSent = serial.size() == 2 * sizeof(RS::AckMessage) + 4 && serial.data()[5] == RS::Wait
+		&& serial.data()[sizeof(RS::AckMessage) + 2 + 5] == RS::Wait;
+	serial.clear();
+
+	const uint32_t slowValue = 0x12345678;
+	deferred.completeCommand(deferred.command, RS::Ok);
+	const bool commandCompleted = serial.size() == sizeof(RS::AckMessage) + 2 && serial.data()[1] == 0xAB
+		&& serial.data()[4] == 0x01 && serial.data()[5] == RS::Ok;
+	serial.clear();
+	const bool requestCompleted = deferred.completeBlobRequest(deferred.request, &slowValue, sizeof(slowValue))
+		&& serial.size() == copySerial.size() / 3 && !memcmp(serial.data(), copySerial.data() + 2 * serial.size(), serial.size());
+	const bool deferredAnswers = waitSent && commandCompleted && requestCompleted;
+	std::cout << (deferredAnswers ? "Deferred answers sent" : "Deferred answers failed") << std::endl;
+
+	return sealedFramesMatch && acksBatched && templatesMatch && staticDispatch && messageSet && responseCache && blobSource
+		&& deferredAnswers ? 0 : 1;
 
 	//	uint8_t ackBuffer[] = {0x52, 0xff, 0x01, 0x03, 0x06, 0x00, 0x08};
 	//	handler.update(ackBuffer, sizeof(ackBuffer));
@@ -1,11 +1,11 @@
 
 #include "Mocks/MockTime.hpp"
 #include <UtilitaryRS/Crc64.hpp>
+#include <UtilitaryRS/Crc64Legacy.hpp>
 #include <UtilitaryRS/Crc8.hpp>
 #include <UtilitaryRS/RsTypes.hpp>
 #include <UtilitaryRS/DeviceHub.hpp>
 
-#include <cassert>
 #include <chrono>
 #include <iostream>
 #include <vector>
@@ -41,7 +41,7 @@ private:
 	std::vector<uint8_t> buf;
 };
 
-template<typename Interface, typename Crc, size_t ParserSize>
+template<typename Interface, typename Crc, size_t ParserSize, typename CrcFile = Crc64>
 class DeviceNode : public RS::RsHandler<Interface, Crc, ParserSize> {
 public:
 	DeviceNode(const char *aName, RS::DeviceVersion &ver, uint8_t uid, Interface &iface) :
@@ -67,7 +67,12 @@ public:
 	{
 		if (aCommand == 0x06 && aArgument == 0x07) {
 			commandReceived = true;
+			++commands;
 			return RS::Result::Ok;
+		} else if (aCommand == 0x08) {
+			// Медленная команда: ответ отправит тест через completeCommand
+			deferred = this->defer();
+			return RS::Result::Wait;
 		} else {
 			return RS::Result::InvalidArg;
 		}
@@ -75,6 +80,8 @@ public:
 
 	RS::Result handleFileWriteRequest(uint8_t /*uid*/, uint8_t aFile, uint32_t aFileSize) override
 	{
+		++fileRequests;
+
 		if (aFile == 0) {
 			recvBuf.clear();
 			recvBuf.reserve(aFileSize);
@@ -94,7 +101,7 @@ public:
 
 	RS::Result handleWriteChunkFinalize(uint8_t /*uid*/, uint8_t /*msgNum*/, uint16_t /*chunks*/, uint64_t crc) override
 	{
-		uint64_t calc = Crc64::calculate(recvBuf.data(), recvBuf.size());
+		uint64_t calc = CrcFile::calculate(recvBuf.data(), recvBuf.size());
 		if (calc == crc && recvBuf.size() == expectedSize) {
 			// Сравним полученный файл с переданным
 
@@ -122,9 +129,18 @@ public:
 		return fileOk;
 	}
 
+	size_t commandCount() const
+	{
+		return commands;
+	}
+
+	RS::PendingAnswer deferred{};
+	size_t fileRequests{0};
+
 private:
 	bool commandReceived{false};
 	bool fileOk{false};
+	size_t commands{0};
 
 	std::vector<uint8_t> recvBuf;
 	size_t expectedSize;
@@ -136,6 +152,7 @@ public:
 	{
 		(void)aMessage;
 		lastNotAckName = aName;
+		++notAcks;
 	}
 	void onAckReceivedEv(const std::string &aName, RS::MessageType aMessage, RS::Result aCode) override
 	{
@@ -147,6 +164,7 @@ public:
 	{
 		lastCommandName = aName;
 		lastCommandResult = aReturn;
+		++commandResults;
 	}
 	void onRequestErrorEv(const std::string &aName, RS::Result aReturn) override
 	{
@@ -187,12 +205,15 @@ public:
 
 	void deviceHealthReceivedEv(const std::string &aName, RS::Health aHealth, uint16_t aFlags) override
 	{
-		return;
+		(void)aHealth;
+		(void)aFlags;
+		lastHealthName = aName;
 	}
 
 	void deviceLostEv(const std::string &aName) override
 	{
-		return;
+		lastLostName = aName;
+		++lost;
 	}
 
 	// тестовые поля
@@ -214,195 +235,499 @@ public:
 	std::string lastFileName;
 	RS::Result lastFileResult{RS::Result::Error};
 
-	bool anwerCorrected;
+	std::string lastLostName;
+	std::string lastHealthName;
+
+	bool anwerCorrected{false};
+	size_t notAcks{0};
+	size_t lost{0};
+	size_t commandResults{0};
 };
 
-int main()
-{
-	using Hub = RS::DeviceHub<2, MockSerial, MockTime, Crc8, Crc64, 256>;
-	using Device = DeviceNode<MockSerial, Crc8, 256>;
+/// \brief Наблюдатель-политика без виртуальных вызовов, запоминает дескрипторы из событий
+class EventRecorder {
+public:
+	void onAckNotReceived(const RS::DeviceEvent &, RS::MessageType) {}
+
+	void onAckReceived(const RS::DeviceEvent &aDevice, RS::MessageType, RS::Result)
+	{
+		acked = aDevice.handle;
+	}
+
+	void onCommandResult(const RS::DeviceEvent &aDevice, RS::Result aReturn)
+	{
+		command = aDevice.handle;
+		commandName = aDevice.name;
+		commandResult = aReturn;
+	}
+
+	void onRequestError(const RS::DeviceEvent &, RS::Result) {}
+
+	RS::Result onBlobAnswer(const RS::DeviceEvent &, uint8_t, const void *, size_t)
+	{
+		return RS::Result::Ok;
+	}
 
-	// Версии
-	RS::DeviceVersion hubVer{};
-	hubVer.hwRevision = 1;
-	hubVer.swMajor = 0;
-	hubVer.swMinor = 1;
-	hubVer.swRevision = 0x1234;
-	hubVer.hash = 0x1111;
+	void onDeviceRegistered(const RS::DeviceEvent &aDevice, RS::DeviceVersion)
+	{
+		registered = aDevice.handle;
+		registeredName = aDevice.name;
+	}
 
-	RS::DeviceVersion devVer{};
-	devVer.hwRevision = 2;
-	devVer.swMajor = 1;
-	devVer.swMinor = 5;
-	devVer.swRevision = 0x80;
-	devVer.hash = 0xAABBCCDD;
+	void onDeviceLost(const RS::DeviceEvent &) {}
 
-	MockSerial masterSerial; // интерфейс для хаба (он пишет сюда)
-	MockSerial deviceSerial; // интерфейс для девайса (он пишет сюда)
+	RS::Result onFileWriteResult(const RS::DeviceEvent &, RS::Result aReturn)
+	{
+		return aReturn;
+	}
 
-	std::string deviceName = "dev1";
+	void onDeviceHealth(const RS::DeviceEvent &aDevice, RS::Health, uint16_t)
+	{
+		health = aDevice.handle;
+	}
+
+	RS::DeviceHandle registered;
+	std::string registeredName;
+	RS::DeviceHandle acked;
+	RS::DeviceHandle command;
+	std::string commandName;
+	RS::Result commandResult{RS::Result::Error};
+	RS::DeviceHandle health;
+};
+
+/// \brief Хаб и устройства на общей линии, время идет только по команде теста
+template<typename Observer, typename CrcFile = Crc64>
+class TestBus {
+public:
+	using Hub = RS::DeviceHub<4, MockSerial, ManualTime, Crc8, CrcFile, 256, Observer>;
+	using Device = DeviceNode<MockSerial, Crc8, 256, CrcFile>;
+	using Node = RS::RsHandler<MockSerial, Crc8, 256>; // Устройство на линии, в том числе с другим CrcFile
+
+	explicit TestBus(Observer &aObserver) : hub{hubVersion(), down}
+	{
+		hub.registerObserver(&aObserver);
+	}
 
-	// Создаем hub и device
-	Hub hub(hubVer, masterSerial);
-	Device device(deviceName.c_str(), devVer, 1, deviceSerial);
+	/// \brief Подключить устройство к линии и опросить шину, регистрация проходит без продвижения времени
+	void attach(Node &aDevice)
+	{
+		devices.push_back(&aDevice);
+		hub.probeAll();
+		settle();
+	}
+
+	/// \brief Отключить все устройства: дальше хаб не получает ответов
+	void detach()
+	{
+		devices.clear();
+	}
+
+	/// \brief Передавать сообщения в обе стороны, пока линии не опустеют
+	/// \return true, если что-то было передано
+	bool pump()
+	{
+		bool transferred = false;
+
+		while (true) {
+			const auto m2d = down.readAll();
+			for (auto *device : devices) { device->update(m2d.data(), m2d.size()); }
+
+			const auto d2m = up.readAll();
+			hub.update(d2m.data(), d2m.size());
+
+			if (m2d.empty() && d2m.empty()) {
+				return transferred;
+			}
+
+			transferred = true;
+		}
+	}
+
+	/// \brief Довести обмен до конца без продвижения времени
+	void settle()
+	{
+		runUntil(ManualTime::now);
+	}
+
+	/// \brief Прогнать хаб до момента aTime, process() вызывается в сроки, которые он сам вернул
+	void runUntil(std::chrono::milliseconds aTime)
+	{
+		while (true) {
+			const auto deadline = hub.process(ManualTime::now);
+
+			// Ответы устройств могли сделать срок ближе
+			if (pump()) {
+				continue;
+			}
+
+			if (deadline > aTime) {
+				break;
+			}
+
+			ManualTime::now = deadline;
+		}
+
+		ManualTime::now = aTime;
+	}
+
+	void runFor(std::chrono::milliseconds aTime)
+	{
+		runUntil(ManualTime::now + aTime);
+	}
+
+	MockSerial down; // хаб -> устройства
+	MockSerial up; // устройства -> хаб
+	Hub hub;
+
+private:
+	std::vector<Node *> devices;
 
+	static RS::DeviceVersion hubVersion()
+	{
+		RS::DeviceVersion version{};
+		version.hwRevision = 1;
+		version.swMajor = 0;
+		version.swMinor = 1;
+		version.swRevision = 0x1234;
+		version.hash = 0x1111;
+		return version;
+	}
+};
+
+using Device = TestBus<RS::DeviceHubEventObserver>::Device;
+
+RS::DeviceVersion deviceVersion()
+{
+	RS::DeviceVersion version{};
+	version.hwRevision = 2;
+	version.swMajor = 1;
+	version.swMinor = 5;
+	version.swRevision = 0x80;
+	version.hash = 0xAABBCCDD;
+	return version;
+}
+
+/// \brief Регистрация, команда, запрос и передача файла через наблюдателя по именам
+bool exchange()
+{
 	DeviceHubObserverMock obs;
-	hub.registerObserver(&obs);
-	// Начнем опрос устройств
-	hub.probeAll();
-	// Передадим данные из мастера в устройство
-	auto m2d = masterSerial.readAll();
-	assert(!m2d.empty()); // мы должны получить probe
-	device.update(m2d.data(), m2d.size());
-	// Девайс должен отправить ack
-	auto d2m = deviceSerial.readAll();
-	assert(!d2m.empty());
-	hub.update(d2m.data(), d2m.size());
-
-	// После получения ACK hub должен создать запись (в handleAck он делает hub[uid] = DeviceWrapper{})
-	// и на следующем process отправит DeviceInfoReq. Вызовем process с текущим временем.
-	hub.process(MockTime::milliseconds());
-
-	// hub написал DeviceInfoReq в masterSerial
-	m2d = masterSerial.readAll();
-	assert(!m2d.empty());
-	device.update(m2d.data(), m2d.size());
-
-	// device ответил DeviceInfoAnw (в процессе processDeviceInfoRequest)
-	d2m = deviceSerial.readAll();
-	assert(!d2m.empty());
-	hub.update(d2m.data(), d2m.size());
-
-	// После обработки DeviceInfoAnw observer должен получить уведомление и заполнить lastDeviceRegistered
-	MockTime::delay(std::chrono::milliseconds{1000});
-	hub.process(MockTime::milliseconds());
-
-	// Проверки
-	if (obs.lastDeviceRegistered != deviceName) {
-		std::cerr << "Device was not registered: expected 'dev1', got '" << obs.lastDeviceRegistered << "'\n";
-		return 1;
-	}
-
-	std::cout << "Device registered: " << obs.lastDeviceRegistered << "\n";
-
-	// Тестируем интерфейсы Hub
-	// === 1) Отправка команды (hub -> device) и ACK ===
-	bool r = hub.sendCmdToDevice(deviceName, 0x06, 0x07);
-	assert(r && "sendCmdToDevice returned false");
-
-	// Дадим время, чтобы process отправил команду
-	MockTime::delay(std::chrono::milliseconds{50});
-	hub.process(MockTime::milliseconds());
-
-	// master -> device (команда)
-	m2d = masterSerial.readAll();
-	assert(!m2d.empty());
-	device.update(m2d.data(), m2d.size());
-
-	// device обработал команду и отправил ACK
-	d2m = deviceSerial.readAll();
-	assert(!d2m.empty());
-	hub.update(d2m.data(), d2m.size());
-
-	// обработано — observer должен получить onCommandResultEv
-	if (obs.lastCommandName != deviceName || obs.lastCommandResult != RS::Result::Ok) {
-		std::cerr << "Command path failed: lastCommandName='" << obs.lastCommandName
-				  << "', result=" << static_cast<int>(obs.lastCommandResult) << "\n";
-		return 2;
+	TestBus<RS::DeviceHubEventObserver> bus{obs};
+	RS::DeviceVersion version = deviceVersion();
+	Device device("dev1", version, 1, bus.up);
+	bus.attach(device);
+
+	if (obs.lastDeviceRegistered != "dev1" || obs.deviceVersion.hash != version.hash) {
+		std::cerr << "Device was not registered: expected 'dev1', got '" << obs.lastDeviceRegistered << "'" << std::endl;
+		return false;
 	}
-	std::cout << "Command OK\n";
 
-	// Дополнительно убедимся, что self device получил команду (в DeviceNode мы помечаем флаг)
-	if (!device.wasCommandReceived()) {
-		std::cerr << "DeviceNode didn't register receiving command\n";
-		return 3;
+	// Команда уходит сразу, как только устройство ответит на текущую транзакцию
+	const bool commandQueued = bus.hub.sendCmdToDevice("dev1", 0x06, 0x07);
+	bus.settle();
+
+	if (!commandQueued || obs.lastCommandName != "dev1" || obs.lastCommandResult != RS::Result::Ok
+		|| !device.wasCommandReceived()) {
+		std::cerr << "Command path failed: lastCommandName='" << obs.lastCommandName
+				  << "', result=" << static_cast<int>(obs.lastCommandResult) << std::endl;
+		return false;
 	}
 
-	// === 2) Blob request (hub -> device -> blob answer -> hub) ===
 	// Hub запросит 4 байта по request id = 2
-	bool sendBlob = hub.sendBlobRequestToDevice(deviceName, 2 /* req */, 4 /* size */);
-	assert(sendBlob && "sendBlobRequestToDevice returned false");
+	const bool blobQueued = bus.hub.sendBlobRequestToDevice("dev1", 2, 4);
+	bus.settle();
+
+	if (!blobQueued || obs.lastBlobName != "dev1" || !obs.anwerCorrected) {
+		std::cerr << "Blob handling failed: expected blob from 'dev1', got '" << obs.lastBlobName << "'" << std::endl;
+		return false;
+	}
 
-	// Позволим hub'у отправить запрос
-	MockTime::delay(std::chrono::milliseconds{50});
-	hub.process(MockTime::milliseconds());
+	// Файл с заранее известным содержимым, его проверяет DeviceNode
+	uint8_t buffer[128];
+	for (size_t i = 0; i < sizeof(buffer); ++i) { buffer[i] = static_cast<uint8_t>(i); }
 
-	// master -> device (BlobRequest)
-	m2d = masterSerial.readAll();
-	assert(!m2d.empty());
-	device.update(m2d.data(), m2d.size());
+	const bool fileStarted = bus.hub.sendFile("dev1", 0, buffer, sizeof(buffer), 16);
 
-	// device должен ответить BlobAnswer (sendAnswer внутри processBlobRequest)
-	d2m = deviceSerial.readAll();
-	assert(!d2m.empty());
-	hub.update(d2m.data(), d2m.size());
+	// Запрос на запись уходит в ближайшем process(), не дожидаясь срока health
+	bus.hub.process(ManualTime::now);
+	bus.pump();
 
-	// После обработки BlobAnswer observer должен видеть имя устройства
-	if (obs.lastBlobName != deviceName) {
-		std::cerr << "Blob handling failed: expected blob from '" << deviceName << "', got '" << obs.lastBlobName
-				  << "'\n";
-		return 4;
+	if (device.fileRequests != 1) {
+		std::cerr << "FileWriteRequest was not sent by the next process()" << std::endl;
+		return false;
 	}
 
-	if (obs.anwerCorrected) {
-		std::cout << "Blob OK\n";
-	} else {
-		std::cerr << "Blob handling failed\n";
+	bus.runFor(std::chrono::milliseconds{5000});
+
+	if (!fileStarted || obs.lastFileName != "dev1" || obs.lastFileResult != RS::Result::Ok || !device.isFileOk()) {
+		std::cerr << "File transfer failed, result=" << static_cast<int>(obs.lastFileResult) << std::endl;
+		return false;
 	}
 
-	// Теперь попробуем передать файл
-	// Просто файл с заранее известным содержимым
+	// Устройство отвечало на все, таймаутов быть не должно
+	if (obs.notAcks != 0) {
+		std::cerr << "Unexpected answer timeouts: " << obs.notAcks << std::endl;
+		return false;
+	}
+
+	std::cout << "Command, blob and file transfer OK" << std::endl;
+	return true;
+}
+
+/// \brief Поиск по имени, имя по дескриптору и отказ по устаревшему дескриптору, в том числе после
+/// перерегистрации устройства под другим именем на том же UID
+bool handles()
+{
+	DeviceHubObserverMock obs;
+	TestBus<RS::DeviceHubEventObserver> bus{obs};
+	RS::DeviceVersion version = deviceVersion();
+	Device device("dev1", version, 1, bus.up);
+	bus.attach(device);
+
+	const RS::DeviceHandle handle = bus.hub.findDevice("dev1");
+	const RS::DeviceHandle stale{handle.uid, handle.generation + 1};
+
+	bool lookup = handle.valid() && handle.uid == 1 && bus.hub.deviceName(handle) == "dev1";
+	lookup &= !bus.hub.findDevice("dev2").valid() && bus.hub.deviceName(RS::DeviceHandle{}).empty();
+	lookup &= bus.hub.deviceName(stale).empty() && !bus.hub.sendCmdToDevice(stale, 0x06, 0x07);
+	lookup &= bus.hub.sendCmdToDevice(handle, 0x06, 0x07);
+	bus.settle();
+	lookup &= device.wasCommandReceived();
+
+	// Устройство пропадает, а на его UID регистрируется другое устройство
+	bus.detach();
+	bus.runFor(std::chrono::milliseconds{30000});
+	Device replacement("dev1b", version, 1, bus.up);
+	bus.attach(replacement);
+	bus.runFor(std::chrono::milliseconds{3000});
+
+	const RS::DeviceHandle renewed = bus.hub.findDevice("dev1b");
+	bool reregistered = obs.lost == 1 && obs.lastLostName == "dev1" && obs.lastDeviceRegistered == "dev1b";
+	reregistered &= renewed.valid() && renewed.uid == handle.uid && renewed.generation != handle.generation;
+	reregistered &= !bus.hub.findDevice("dev1").valid() && bus.hub.deviceName(handle).empty();
+	reregistered &= !bus.hub.sendCmdToDevice(handle, 0x06, 0x07) && bus.hub.sendCmdToDevice(renewed, 0x06, 0x07);
+	bus.settle();
+	reregistered &= replacement.wasCommandReceived();
+
+	// Перерегистрированное устройство по-прежнему обслуживается по очереди сроков
+	const size_t timeouts = obs.notAcks;
+	bus.detach();
+	bus.runFor(std::chrono::milliseconds{2000});
+	reregistered &= obs.notAcks > timeouts;
+
+	std::cout << (lookup ? "Handle lookup OK" : "Handle lookup failed") << std::endl;
+	std::cout << (reregistered ? "Stale handle after re-registration rejected" : "Re-registration handling failed")
+			  << std::endl;
+	return lookup && reregistered;
+}
+
+bool sameDevice(RS::DeviceHandle aLeft, RS::DeviceHandle aRight)
+{
+	return aLeft.valid() && aLeft.uid == aRight.uid && aLeft.generation == aRight.generation;
+}
+
+/// \brief События доходят с дескриптором до наблюдателя-политики и с именем до DeviceHubObserver
+bool events()
+{
+	RS::DeviceVersion version = deviceVersion();
+
+	EventRecorder recorder;
+	TestBus<EventRecorder> policyBus{recorder};
+	Device policyDevice("dev1", version, 1, policyBus.up);
+	policyBus.attach(policyDevice);
+	policyBus.hub.sendCmdToDevice("dev1", 0x06, 0x07);
+	policyBus.settle();
+
+	const RS::DeviceHandle handle = policyBus.hub.findDevice("dev1");
+	bool policy = sameDevice(recorder.registered, handle) && recorder.registeredName == "dev1";
+	policy &= sameDevice(recorder.health, handle) && sameDevice(recorder.acked, handle);
+	policy &= sameDevice(recorder.command, handle) && recorder.commandName == "dev1"
+		&& recorder.commandResult == RS::Result::Ok;
+
+	DeviceHubObserverMock obs;
+	TestBus<RS::DeviceHubEventObserver> namedBus{obs};
+	Device namedDevice("dev2", version, 2, namedBus.up);
+	namedBus.attach(namedDevice);
+	namedBus.hub.sendCmdToDevice("dev2", 0x06, 0x07);
+	namedBus.settle();
+	namedBus.detach();
+	namedBus.runFor(std::chrono::milliseconds{1200});
+
+	bool named = obs.lastDeviceRegistered == "dev2" && obs.lastHealthName == "dev2" && obs.lastAckName == "dev2";
+	named &= obs.lastCommandName == "dev2" && obs.lastCommandResult == RS::Result::Ok;
+	named &= obs.notAcks == 1 && obs.lastNotAckName == "dev2";
+
+	std::cout << (policy ? "Policy observer events OK" : "Policy observer events failed") << std::endl;
+	std::cout << (named ? "Named observer events OK" : "Named observer events failed") << std::endl;
+	return policy && named;
+}
+
+/// \brief process() возвращает ближайший срок: kNoDeadline без устройств, иначе health, телеметрию или таймаут
+bool deadlines()
+{
+	using Hub = TestBus<RS::DeviceHubEventObserver>::Hub;
+	using std::chrono::milliseconds;
+
+	DeviceHubObserverMock obs;
+	TestBus<RS::DeviceHubEventObserver> bus{obs};
+	RS::DeviceVersion version = deviceVersion();
+
+	bool result = bus.hub.process(ManualTime::now) == Hub::kNoDeadline;
+
+	Device device("dev1", version, 1, bus.up);
+	bus.attach(device);
+	const auto start = ManualTime::now;
+
+	// Health ушел при регистрации, следующий - через секунду
+	result &= bus.hub.process(start) == start + milliseconds{1000};
+
+	// Опрос телеметрии уходит сразу, следующий - через свой период
+	result &= bus.hub.createSchedRequest("dev1", 2, 4, milliseconds{300});
+	bus.settle();
+	result &= bus.hub.process(start) == start + milliseconds{300};
+
+	// Без ответа срок - таймаут транзакции, раньше него process() ничего не делает
+	bus.detach();
+	result &= bus.hub.sendCmdToDevice("dev1", 0x06, 0x07);
+	result &= bus.hub.process(start) == start + milliseconds{200};
+
+	ManualTime::now = start + milliseconds{199};
+	result &= bus.hub.process(ManualTime::now) == start + milliseconds{200} && obs.notAcks == 0;
+
+	ManualTime::now = start + milliseconds{200};
+	result &= bus.hub.process(ManualTime::now) == start + milliseconds{300} && obs.notAcks == 1;
+
+	std::cout << (result ? "Deadlines OK" : "Deadlines failed") << std::endl;
+	return result;
+}
+
+/// \brief Очередь уходит подряд по Ack без ожидания времени, а setSendInterval разносит транзакции
+bool pacing()
+{
+	using std::chrono::milliseconds;
+
+	DeviceHubObserverMock obs;
+	TestBus<RS::DeviceHubEventObserver> bus{obs};
+	RS::DeviceVersion version = deviceVersion();
+	Device device("dev1", version, 1, bus.up);
+	bus.attach(device);
+
+	const RS::DeviceHandle handle = bus.hub.findDevice("dev1");
+	const auto start = ManualTime::now;
+
+	// Каждая следующая команда уходит по Ack на предыдущую, process() по времени для этого не нужен
+	for (size_t i = 0; i < 10; ++i) { bus.hub.sendCmdToDevice(handle, 0x06, 0x07); }
+	bus.pump();
+	const bool drained = device.commandCount() == 10 && obs.commandResults == 10 && ManualTime::now == start;
+
+	// С ограничением частоты следующая команда ждет интервал после предыдущей
+	bus.hub.setSendInterval(milliseconds{100});
+	for (size_t i = 0; i < 3; ++i) { bus.hub.sendCmdToDevice(handle, 0x06, 0x07); }
+	bus.settle();
+
+	bool limited = device.commandCount() == 11 && bus.hub.process(start) == start + milliseconds{100};
+	bus.runUntil(start + milliseconds{99});
+	limited &= device.commandCount() == 11;
+	bus.runUntil(start + milliseconds{100});
+	limited &= device.commandCount() == 12;
+	bus.runUntil(start + milliseconds{199});
+	limited &= device.commandCount() == 12;
+	bus.runUntil(start + milliseconds{200});
+	limited &= device.commandCount() == 13 && obs.commandResults == 13 && obs.notAcks == 0;
+
+	std::cout << (drained ? "Back-to-back drain OK" : "Back-to-back drain failed") << std::endl;
+	std::cout << (limited ? "Send interval OK" : "Send interval failed") << std::endl;
+	return drained && limited;
+}
+
+/// \brief Ack(Wait) на команду продлевает ожидание окончательного ответа до kDeferredTimeout
+bool deferredAnswer()
+{
+	using std::chrono::milliseconds;
+
+	DeviceHubObserverMock obs;
+	TestBus<RS::DeviceHubEventObserver> bus{obs};
+	RS::DeviceVersion version = deviceVersion();
+	Device device("dev1", version, 1, bus.up);
+	bus.attach(device);
+
+	const RS::DeviceHandle handle = bus.hub.findDevice("dev1");
+	const auto start = ManualTime::now;
+
+	bus.hub.sendCmdToDevice(handle, 0x08, 0);
+	bus.settle();
+
+	// Обычные 200 мс прошли, но хаб ждет, а health не вклинивается в открытую транзакцию
+	bool completed = bus.hub.process(start) == start + milliseconds{2000};
+	bus.runFor(milliseconds{1000});
+	completed &= obs.notAcks == 0 && obs.commandResults == 0;
+
+	device.completeCommand(device.deferred, RS::Result::Ok);
+	bus.settle();
+	completed &= obs.notAcks == 0 && obs.commandResults == 1 && obs.lastCommandResult == RS::Result::Ok;
+
+	// Без окончательного ответа таймаут наступает через kDeferredTimeout после Ack(Wait)
+	bus.hub.sendCmdToDevice(handle, 0x08, 0);
+	bus.settle();
+	const auto waitAck = ManualTime::now;
+
+	bus.runUntil(waitAck + milliseconds{1999});
+	bool expired = obs.notAcks == 0;
+	bus.runUntil(waitAck + milliseconds{2000});
+	expired &= obs.notAcks == 1 && obs.lastNotAckName == "dev1" && obs.commandResults == 1;
+
+	std::cout << (completed ? "Deferred command completed" : "Deferred command failed") << std::endl;
+	std::cout << (expired ? "Deferred command timed out" : "Deferred command timeout failed") << std::endl;
+	return completed && expired;
+}
+
+/// \brief Передать тестовый файл устройству
+/// \return результат, который хаб сообщил наблюдателю
+template<typename Bus>
+RS::Result transferFile(Bus &aBus, DeviceHubObserverMock &aObserver)
+{
 	uint8_t buffer[128];
-	for (auto i = 0; i < 128; ++i) { buffer[i] = i; }
-	// Инициируем отправку файла 0
-	hub.sendFile(deviceName, 0, buffer, sizeof(buffer), 16);
-	MockTime::delay(std::chrono::milliseconds{1000});
-	hub.process(MockTime::milliseconds());
-	// Прилетает реквест, должен вернуть OK
-	MockTime::delay(std::chrono::milliseconds{50});
-	m2d = masterSerial.readAll();
-	assert(!m2d.empty());
-	device.update(m2d.data(), m2d.size());
-
-	// Начинаем запись файла
-	for (int i = 0; i < 8; ++i) {
-		d2m = deviceSerial.readAll();
-		assert(!d2m.empty());
-		hub.update(d2m.data(), d2m.size());
-
-		MockTime::delay(std::chrono::milliseconds{100});
-		hub.process(MockTime::milliseconds());
-		MockTime::delay(std::chrono::milliseconds{100});
-
-		m2d = masterSerial.readAll();
-		assert(!m2d.empty());
-		device.update(m2d.data(), m2d.size());
-		MockTime::delay(std::chrono::milliseconds{60});
-	}
-
-	d2m = deviceSerial.readAll();
-	assert(!d2m.empty());
-	hub.update(d2m.data(), d2m.size());
-	// Тут мы отметим факт отправки всех чанков и перейдем в finalize
-	MockTime::delay(std::chrono::milliseconds{100});
-	hub.process(MockTime::milliseconds());
-	MockTime::delay(std::chrono::milliseconds{1010});
-	// А тут произойдет отправка Finalize пакета
-	hub.process(MockTime::milliseconds());
-	// Передадим пакет девайсу
-	MockTime::delay(std::chrono::milliseconds{100});
-	m2d = masterSerial.readAll();
-	assert(!m2d.empty());
-	device.update(m2d.data(), m2d.size());
-	// Девайс должен посчитать CRC и вернуть статус получения отправленного файла
-	MockTime::delay(std::chrono::milliseconds{100});
-	d2m = deviceSerial.readAll();
-	assert(!d2m.empty());
-	hub.update(d2m.data(), d2m.size());
-
-	assert(obs.anwerCorrected && device.isFileOk());
-	std::cout << "File Transfer OK\n";
-	std::cout << "ALL TESTS PASSED\n";
-
-	return 0;
+	for (size_t i = 0; i < sizeof(buffer); ++i) { buffer[i] = static_cast<uint8_t>(i); }
+
+	aObserver.lastFileResult = RS::Result::Error;
+	aBus.hub.sendFile("dev1", 0, buffer, sizeof(buffer), 16);
+	aBus.runFor(std::chrono::milliseconds{5000});
+	return aObserver.lastFileResult;
+}
+
+/// \brief Хаб с CrcFile = Crc64Legacy передает файлы устройству, проверяющему прежним CRC, а хаб с Crc64 - нет
+bool legacyFileCrc()
+{
+	RS::DeviceVersion version = deviceVersion();
+
+	DeviceHubObserverMock legacyObs;
+	TestBus<RS::DeviceHubEventObserver, Crc64Legacy> legacyBus{legacyObs};
+	TestBus<RS::DeviceHubEventObserver, Crc64Legacy>::Device legacyDevice("dev1", version, 1, legacyBus.up);
+	legacyBus.attach(legacyDevice);
+	const bool legacy = transferFile(legacyBus, legacyObs) == RS::Result::Ok && legacyDevice.isFileOk();
+
+	DeviceHubObserverMock mixedObs;
+	TestBus<RS::DeviceHubEventObserver> mixedBus{mixedObs};
+	TestBus<RS::DeviceHubEventObserver, Crc64Legacy>::Device oldFirmware("dev1", version, 1, mixedBus.up);
+	mixedBus.attach(oldFirmware);
+	const bool mismatch = transferFile(mixedBus, mixedObs) != RS::Result::Ok && !oldFirmware.isFileOk();
+
+	std::cout << (legacy && mismatch ? "Legacy file CRC OK" : "Legacy file CRC failed") << std::endl;
+	return legacy && mismatch;
+}
+
+int main()
+{
+	bool success = true;
+
+	success &= exchange();
+	success &= handles();
+	success &= events();
+	success &= deadlines();
+	success &= pacing();
+	success &= deferredAnswer();
+	success &= legacyFileCrc();
+	std::cout << (success ? "ALL TESTS PASSED" : "HUB TESTS FAILED") << std::endl;
+
+	return success ? 0 : 1;
 }
+// NOLINTEND
@@ -56,4 +56,31 @@ private:
 	std::vector<uint8_t> vector;
 };
 
+/// \brief Интерфейс, выдающий слот для сборки сообщения по месту, как DMA или кольцевой буфер
+class MockDmaSerial : public MockSerial {
+public:
+	uint8_t *reserve(size_t aLength)
+	{
+		return aLength <= sizeof(slot) ? slot : nullptr;
+	}
+
+	void commit(size_t aLength)
+	{
+		++commits;
+		MockSerial::write(slot, aLength);
+	}
+
+	size_t write(const uint8_t *aData, size_t aLength)
+	{
+		++writes;
+		return MockSerial::write(aData, aLength);
+	}
+
+	size_t commits{0};
+	size_t writes{0};
+
+private:
+	uint8_t slot[64];
+};
+
 #endif // MOCKSERIAL_HPP
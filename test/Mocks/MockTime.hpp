@@ -26,4 +26,15 @@ public:
 	}
 };
 
+/// \brief Часы, которыми управляет сам тест
+class ManualTime {
+public:
+	static std::chrono::milliseconds milliseconds()
+	{
+		return now;
+	}
+
+	static inline std::chrono::milliseconds now{10000};
+};
+
 #endif // MOCKTIME_HPP
@@ -3,8 +3,13 @@
 #include <UtilitaryRS/RsTypes.hpp>
 #include <UtilitaryRS/Crc8.hpp>
 
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <vector>
 
 #define GEN_BUF
 
@@ -383,6 +388,515 @@ bool createAndParseHealthAnwMessage()
 	}
 }
 
+bool createAndParseEmptyBlobAnswerMessage()
+{
+	RS::RsParser<512, Crc8> parser;
+	RS::BlobAnwMessage message;
+	uint8_t buffer[100];
+
+	message.receiverUID = 0xFF;
+	message.transmitUID = 0x01;
+	message.messageType = RS::MessageType::BlobAnswer;
+	message.payload.request = 0x07;
+	message.payload.dataSize = 0;
+
+	size_t length = parser.create(buffer, &message, sizeof(message));
+	parser.update(buffer, length);
+
+	printBuffer(buffer, length);
+
+	if (parser.isReady()) {
+		std::cout << "Empty answer message parsed" << std::endl;
+		return true;
+	} else {
+		std::cout << "Empty answer parsing failed" << std::endl;
+		return false;
+	}
+}
+
+struct CustomPayload {
+	uint16_t value;
+	uint8_t size;
+} __attribute__((packed));
+using CustomMessage = RS::Packet<CustomPayload>;
+
+static constexpr auto kCustomConst = static_cast<RS::MessageType>(0x40);
+static constexpr auto kCustomVolatile = static_cast<RS::MessageType>(0x41);
+
+using CustomLayout = RS::DefaultMessageLayout::Extend<
+	RS::LayoutEntry<kCustomConst, CustomMessage>,
+	RS::LayoutEntry<kCustomVolatile, CustomMessage, 16>>;
+
+static_assert(CustomLayout::get(RS::MessageType::Command).size == sizeof(RS::ComMessage));
+static_assert(CustomLayout::get(kCustomVolatile).maxPayload == 16);
+static_assert(!RS::DefaultMessageLayout::get(kCustomConst).isSupported());
+
+bool parseCustomLayoutMessages()
+{
+	RS::RsParser<100, Crc8, CustomLayout> parser;
+	RS::RsParser<100, Crc8> defaultParser;
+	uint8_t raw[sizeof(CustomMessage) + 16];
+	uint8_t buffer[100];
+	bool success = true;
+
+	CustomMessage message;
+	message.receiverUID = 0x01;
+	message.transmitUID = 0x02;
+	message.messageType = kCustomConst;
+	message.number = 0x03;
+	message.payload.value = 0x1234;
+	message.payload.size = 4;
+
+	size_t length = parser.create(buffer, &message, sizeof(message));
+	parser.update(buffer, length);
+	success &= parser.isReady() && parser.length() == sizeof(message);
+
+	defaultParser.update(buffer, length);
+	success &= !defaultParser.isReady();
+
+	// Переменное сообщение: последний байт базовой части - длина хвоста
+	message.messageType = kCustomVolatile;
+	memcpy(raw, &message, sizeof(message));
+	memset(raw + sizeof(message), 0xAA, message.payload.size);
+
+	length = parser.create(buffer, raw, sizeof(message) + message.payload.size);
+	for (size_t i = 0; i < length; ++i) { parser.update(&buffer[i], 1); }
+	success &= parser.isReady() && parser.length() == sizeof(message) + message.payload.size;
+
+	// Хвост длиннее разрешенного таблицей
+	message.payload.size = 17;
+	memcpy(raw, &message, sizeof(message));
+	length = parser.create(buffer, raw, sizeof(raw));
+	parser.reset();
+	parser.update(buffer, length);
+	success &= !parser.isReady();
+
+	std::cout << (success ? "Custom layout messages parsed" : "Custom layout parsing failed") << std::endl;
+	return success;
+}
+
+bool parseWithReceiverFilter()
+{
+	RS::RsParser<300, Crc8> parser;
+	std::vector<uint8_t> stream;
+	uint8_t buffer[300];
+	uint8_t raw[300];
+
+	// Сообщения для нод 0x01..0x04 и широковещательные, постоянные и переменные вперемешку
+	for (uint8_t i = 0; i < 40; ++i) {
+		RS::ComMessage command;
+		command.receiverUID = i % 5 == 4 ? RS::kReservedUID : static_cast<uint8_t>(i % 5 + 1);
+		command.transmitUID = 0x00;
+		command.messageType = RS::MessageType::Command;
+		command.number = i;
+		command.payload.command = 'R';
+		command.payload.value = 'R';
+		command.payload.reserved = 0;
+		size_t length = parser.create(buffer, &command, sizeof(command));
+		stream.insert(stream.end(), buffer, buffer + length);
+
+		RS::FileWriteChunkMessage chunk;
+		chunk.receiverUID = static_cast<uint8_t>(i % 4 + 1);
+		chunk.transmitUID = 0x00;
+		chunk.messageType = RS::MessageType::FileWriteChunk;
+		chunk.number = i;
+		chunk.payload.fileNum = 1;
+		chunk.payload.chunkSize = 200;
+		memcpy(raw, &chunk, sizeof(chunk));
+		// Внутри чужого сообщения лежит валидное сообщение для нашей ноды - его не должно быть видно
+		memcpy(raw + sizeof(chunk), buffer, length);
+		memset(raw + sizeof(chunk) + length, 'R', 200 - length);
+		length = parser.create(buffer, raw, sizeof(chunk) + 200);
+		stream.insert(stream.end(), buffer, buffer + length);
+	}
+
+	parser.setReceiverFilter(0x02);
+	bool success = !parser.isAccepted(0x01) && parser.isAccepted(0x02) && parser.isAccepted(RS::kReservedUID);
+
+	for (size_t step : {size_t{1}, size_t{7}, stream.size()}) {
+		size_t commands = 0;
+		size_t chunks = 0;
+		bool foreign = false;
+		parser.reset();
+
+		for (size_t offset = 0; offset < stream.size(); offset += step) {
+			parser.parse(&stream[offset], std::min(step, stream.size() - offset), [&](const uint8_t *aFrame, size_t) {
+				const auto *header = reinterpret_cast<const RS::Header *>(aFrame);
+				foreign |= !parser.isAccepted(header->receiverUID);
+				commands += header->messageType == RS::MessageType::Command;
+				chunks += header->messageType == RS::MessageType::FileWriteChunk;
+			});
+		}
+
+		// Команды: 8 для ноды 0x02 и 8 широковещательных, чанки: 10 для ноды 0x02
+		success &= !foreign && commands == 16 && chunks == 10;
+	}
+
+	parser.clearReceiverFilter();
+	size_t all = 0;
+	parser.reset();
+	parser.parse(stream.data(), stream.size(), [&all](const uint8_t *, size_t) { ++all; });
+	success &= all == 80;
+
+	std::cout << (success ? "Receiver filter works" : "Receiver filter failed") << std::endl;
+	return success;
+}
+
+bool parseFrameBehindForeignFalsePreamble()
+{
+	RS::RsParser<100, Crc8> parser;
+	std::vector<uint8_t> stream = {0x01, 0x02};
+	uint8_t buffer[100];
+
+	RS::ComMessage command;
+	command.receiverUID = 0x03;
+	command.transmitUID = 0x00;
+	command.messageType = RS::MessageType::Command;
+	command.number = 0x05;
+	command.payload.command = 0x06;
+	command.payload.value = 0x07;
+	command.payload.reserved = 0x08;
+
+	// Ложная преамбула в шуме, за ней заголовок, который читается как команда другой ноде
+	stream.push_back('R');
+	stream.insert(stream.end(), reinterpret_cast<uint8_t *>(&command), reinterpret_cast<uint8_t *>(&command) + sizeof(RS::Header));
+
+	// Следом настоящая команда нашей ноде, ее начало попадает внутрь ложного чужого сообщения
+	command.receiverUID = 0x02;
+	const size_t length = parser.create(buffer, &command, sizeof(command));
+	stream.insert(stream.end(), buffer, buffer + length);
+
+	parser.setReceiverFilter(0x02);
+	bool success = true;
+
+	for (size_t step : {size_t{1}, size_t{3}, stream.size()}) {
+		size_t accepted = 0;
+		parser.reset();
+
+		for (size_t offset = 0; offset < stream.size(); offset += step) {
+			parser.parse(&stream[offset], std::min(step, stream.size() - offset), [&](const uint8_t *aFrame, size_t aLength) {
+				accepted += aLength == sizeof(command) && memcmp(aFrame, &command, sizeof(command)) == 0;
+			});
+		}
+
+		success &= accepted == 1;
+	}
+
+	std::cout << (success ? "Frame behind foreign false preamble parsed" : "Frame behind foreign false preamble lost")
+			  << std::endl;
+	return success;
+}
+
+bool collectLinkStats()
+{
+	using StatsParser = RS::RsParser<100, Crc8, RS::DefaultMessageLayout, RS::LinkStats>;
+	StatsParser parser;
+	std::vector<uint8_t> stream = {0x01, 0x02, 0x03};
+	uint8_t buffer[100];
+
+	RS::ComMessage command;
+	command.receiverUID = 0x01;
+	command.transmitUID = 0x00;
+	command.messageType = RS::MessageType::Command;
+	command.number = 0x01;
+	command.payload.command = 0x06;
+	command.payload.value = 0x07;
+	command.payload.reserved = 0x08;
+
+	// Целое сообщение
+	size_t length = parser.create(buffer, &command, sizeof(command));
+	stream.insert(stream.end(), buffer, buffer + length);
+
+	// Испорченный CRC
+	buffer[length - 1] ^= 0x01;
+	stream.insert(stream.end(), buffer, buffer + length);
+
+	// Сообщение другой ноде
+	command.receiverUID = 0x02;
+	length = parser.create(buffer, &command, sizeof(command));
+	stream.insert(stream.end(), buffer, buffer + length);
+
+	// Неизвестный тип
+	stream.insert(stream.end(), {0x04, 'R', 0x01, 0x00, 0x7F, 0x00});
+
+	// Хвост длиннее буфера
+	RS::BlobAnwMessage answer;
+	answer.receiverUID = 0x01;
+	answer.transmitUID = 0x00;
+	answer.messageType = RS::MessageType::BlobAnswer;
+	answer.number = 0x02;
+	answer.payload.request = 0x01;
+	answer.payload.reserved = 0x00;
+	answer.payload.dataSize = 0xF0;
+	stream.push_back('R');
+	stream.insert(stream.end(), reinterpret_cast<uint8_t *>(&answer), reinterpret_cast<uint8_t *>(&answer) + sizeof(answer));
+
+	bool success = true;
+
+	for (size_t step : {size_t{1}, stream.size()}) {
+		StatsParser counted;
+		counted.setReceiverFilter(0x01);
+
+		for (size_t offset = 0; offset < stream.size(); offset += step) {
+			counted.parse(&stream[offset], std::min(step, stream.size() - offset), [](const uint8_t *, size_t) {});
+		}
+
+		const auto stats = counted.stats().snapshot();
+		success &= stats.bytesReceived == stream.size();
+		success &= stats.framesAccepted[static_cast<size_t>(RS::MessageType::Command)] == 1;
+		success &= std::accumulate(std::begin(stats.framesAccepted), std::end(stats.framesAccepted), 0u) == 1;
+		success &= stats.crcFailures == 1;
+		success &= stats.foreignFrames == 1;
+		success &= stats.headerRejects == 1;
+		success &= stats.oversizeRejects == 1;
+		// 3 байта мусора в начале, 8 байт испорченного сообщения после его преамбулы, байт перед сообщением
+		// неизвестного типа и 4 байта после его преамбулы, 7 байт заголовка слишком длинного ответа
+		success &= stats.bytesDiscarded == 3 + 8 + 1 + 4 + 7;
+	}
+
+	static_assert(sizeof(RS::RsParser<100, Crc8, RS::DefaultMessageLayout, RS::NoLinkStats>) < sizeof(StatsParser));
+
+	std::cout << (success ? "Link stats collected" : "Link stats are wrong") << std::endl;
+	return success;
+}
+
+bool parseMessageInPlaceAndSplit()
+{
+	RS::RsParser<100, Crc8> parser;
+	RS::BlobAnwMessage message;
+	uint8_t preBuffer[100];
+	uint8_t buffer[100];
+	const uint32_t data = 0xAABBCCDD;
+
+	message.receiverUID = 0x01;
+	message.transmitUID = 0x02;
+	message.messageType = RS::MessageType::BlobAnswer;
+	message.number = 3;
+	message.payload.request = 0x07;
+	message.payload.dataSize = sizeof(data);
+
+	memcpy(preBuffer, &message, sizeof(message));
+	memcpy(&preBuffer[sizeof(message)], &data, sizeof(data));
+	const size_t length = parser.create(buffer, preBuffer, sizeof(message) + sizeof(data));
+
+	// Сообщение целиком во входном буфере - парсер отдает указатель прямо на него
+	bool success = parser.update(buffer, length) == length && parser.isReady() && parser.data() == &buffer[1]
+		&& parser.length() == sizeof(message) + sizeof(data);
+
+	// Сообщение пришло двумя кусками - собирается во внутреннем буфере
+	parser.reset();
+	parser.update(buffer, 5);
+	parser.update(&buffer[5], length - 5);
+	success &= parser.isReady() && parser.data() != &buffer[1] && parser.frame().length == sizeof(message) + sizeof(data)
+		&& !memcmp(parser.frame().data, preBuffer, parser.frame().length);
+
+	std::cout << (success ? "In-place and split messages parsed" : "In-place and split parsing failed") << std::endl;
+	return success;
+}
+
+bool parseBatch()
+{
+	RS::RsParser<100, Crc8> parser;
+	uint8_t stream[200];
+	size_t length = 0;
+
+	// Десять Ack подряд в одном буфере
+	for (uint8_t i = 0; i < 10; ++i) {
+		RS::AckMessage message;
+		message.receiverUID = 0x00;
+		message.transmitUID = 0x01;
+		message.messageType = RS::MessageType::Ack;
+		message.number = i;
+		message.payload.code = 0;
+		length += parser.create(&stream[length], &message, sizeof(message));
+	}
+
+	size_t numbers = 0;
+	auto visitor = [&numbers](const uint8_t *aFrame, size_t aLength) {
+		if (aLength == sizeof(RS::AckMessage)) {
+			numbers += aFrame[offsetof(RS::Header, number)];
+		}
+	};
+
+	// Первое сообщение разрезано между двумя чтениями
+	bool success = parser.parse(stream, 3, visitor) == 0;
+	success &= parser.parse(&stream[3], length - 3, visitor) == 10 && numbers == 45;
+
+	// То же самое в массив представлений
+	RS::FrameView frames[16];
+	size_t parsed = 0;
+	parser.reset();
+	parser.parse(stream, 3, frames, 16, parsed);
+	size_t count = parser.parse(&stream[3], length - 3, frames, 16, parsed);
+	success &= count == 1 && parsed == 4;
+	count = parser.parse(&stream[7], length - 7, frames, 16, parsed);
+	success &= count == 9 && parsed == length - 7 && frames[8].data == &stream[length - 6];
+
+	std::cout << (success ? "Batch parsed" : "Batch parsing failed") << std::endl;
+	return success;
+}
+
+bool parseMessageAfterGarbage()
+{
+	RS::RsParser<100, Crc8> parser;
+	RS::ComMessage message;
+	uint8_t frame[100];
+	uint8_t stream[200];
+
+	message.receiverUID = 0x01;
+	message.transmitUID = 0xAB;
+	message.messageType = RS::MessageType::Command;
+	message.number = 1;
+	message.payload.command = 0x06;
+	message.payload.value = 0x07;
+	message.payload.reserved = 0x08;
+
+	const size_t length = parser.create(frame, &message, sizeof(message));
+
+	// Мусор без преамбулы перед сообщением, парсер должен найти начало независимо от разбиения на куски
+	for (size_t i = 0; i < 150; ++i) { stream[i] = static_cast<uint8_t>(i % 0x50); }
+	memcpy(&stream[150], frame, length);
+
+	bool success = true;
+	for (size_t step = 1; step <= 150 + length; ++step) {
+		parser.reset();
+		size_t offset = 0;
+
+		while (offset < 150 + length && !parser.isReady()) {
+			const size_t chunk = std::min(step, 150 + length - offset);
+			offset += parser.update(&stream[offset], chunk);
+		}
+
+		success &= parser.isReady() && parser.length() == sizeof(message)
+			&& !memcmp(parser.data(), &message, sizeof(message));
+	}
+
+	std::cout << (success ? "Message after garbage parsed" : "Message after garbage parsing failed") << std::endl;
+	return success;
+}
+
+bool parseFrameHiddenBehindFalsePreambles()
+{
+	RS::RsParser<100, Crc8> parser;
+	RS::ComMessage message;
+	uint8_t frame[100];
+
+	message.receiverUID = 0x01;
+	message.transmitUID = 0x00;
+	message.messageType = RS::MessageType::Command;
+	message.number = 0x52;
+	message.payload.command = 0x52;
+	message.payload.value = 0x07;
+	message.payload.reserved = 0x08;
+
+	const size_t length = parser.create(frame, &message, sizeof(message));
+
+	// Ложные преамбулы, чьи "заголовки" и "тела" захватывают настоящее сообщение
+	const std::vector<std::vector<uint8_t>> prefixes = {{'R'}, {'R', 0x01}, {'R', 0x00, 0x01, 0x02}, {'R', 0x00, 0x01, 0x04, 0x00, 0x00}};
+	bool success = true;
+
+	for (const auto &prefix : prefixes) {
+		std::vector<uint8_t> stream = prefix;
+		stream.insert(stream.end(), frame, frame + length);
+
+		for (size_t step : {size_t{1}, size_t{3}, stream.size()}) {
+			size_t found = 0;
+			parser.reset();
+
+			for (size_t offset = 0; offset < stream.size(); offset += step) {
+				parser.parse(&stream[offset], std::min(step, stream.size() - offset), [&](const uint8_t *aFrame, size_t aLength) {
+					found += aLength == sizeof(message) && !memcmp(aFrame, &message, sizeof(message));
+				});
+			}
+
+			success &= found == 1;
+		}
+	}
+
+	std::cout << (success ? "Frames behind false preambles parsed" : "Frames behind false preambles lost") << std::endl;
+	return success;
+}
+
+bool parseGoodputWithBitErrors()
+{
+	constexpr size_t kFrames = 4000;
+	constexpr double kBitErrorRate = 1e-4;
+
+	RS::RsParser<300, Crc8> parser;
+	std::mt19937 rng{1};
+	std::uniform_int_distribution<int> byte{0, 255};
+	std::bernoulli_distribution preambleByte{0.25};
+	std::bernoulli_distribution bitError{kBitErrorRate};
+
+	// Нагрузка с большим количеством 'R', чтобы ложные синхронизации случались постоянно
+	std::vector<std::vector<uint8_t>> frames;
+	std::vector<uint8_t> stream;
+	std::vector<size_t> offsets;
+
+	for (size_t i = 0; i < kFrames; ++i) {
+		RS::BlobAnwMessage message;
+		message.receiverUID = 0x00;
+		message.transmitUID = static_cast<uint8_t>(i >> 8);
+		message.messageType = RS::MessageType::BlobAnswer;
+		message.number = static_cast<uint8_t>(i);
+		message.payload.request = 0x01;
+		message.payload.reserved = 0x52;
+		message.payload.dataSize = static_cast<uint8_t>(8 + i % 32);
+
+		std::vector<uint8_t> raw(sizeof(message));
+		memcpy(raw.data(), &message, sizeof(message));
+		for (size_t j = 0; j < message.payload.dataSize; ++j) {
+			raw.push_back(preambleByte(rng) ? 'R' : static_cast<uint8_t>(byte(rng)));
+		}
+
+		uint8_t frame[300];
+		const size_t length = parser.create(frame, raw.data(), raw.size());
+		offsets.push_back(stream.size());
+		stream.insert(stream.end(), frame, frame + length);
+		frames.push_back(raw);
+	}
+	offsets.push_back(stream.size());
+
+	// Инжектим битовые ошибки и запоминаем, какие сообщения остались целыми
+	std::vector<bool> intact(kFrames, true);
+	size_t frame = 0;
+	for (size_t i = 0; i < stream.size(); ++i) {
+		while (i >= offsets[frame + 1]) { ++frame; }
+
+		for (int bit = 0; bit < 8; ++bit) {
+			if (bitError(rng)) {
+				stream[i] ^= static_cast<uint8_t>(1 << bit);
+				intact[frame] = false;
+			}
+		}
+	}
+
+	size_t recovered = 0;
+	std::uniform_int_distribution<size_t> chunk{1, 64};
+
+	for (size_t offset = 0; offset < stream.size();) {
+		const size_t length = std::min(chunk(rng), stream.size() - offset);
+		parser.parse(&stream[offset], length, [&](const uint8_t *aFrame, size_t aLength) {
+			const size_t index = (static_cast<size_t>(aFrame[offsetof(RS::Header, transmitUID)]) << 8)
+				| aFrame[offsetof(RS::Header, number)];
+
+			if (index < kFrames && intact[index] && frames[index].size() == aLength
+				&& !memcmp(frames[index].data(), aFrame, aLength)) {
+				++recovered;
+			}
+		});
+		offset += length;
+	}
+
+	const size_t intactCount = static_cast<size_t>(std::count(intact.begin(), intact.end(), true));
+	const double goodput = static_cast<double>(recovered) / static_cast<double>(intactCount);
+	const bool success = goodput >= 0.99;
+
+	std::cout << std::dec << "Goodput under bit errors: " << recovered << " of " << intactCount << " intact frames ("
+			  << goodput * 100 << "%)" << std::endl;
+	return success;
+}
+
 int main()
 {
 	bool success = true;
@@ -400,6 +914,16 @@ int main()
 	success &= createAndParseDeviceInfoAnwMessage();
 	success &= createAndParseHealthReqMessage();
 	success &= createAndParseHealthAnwMessage();
+	success &= createAndParseEmptyBlobAnswerMessage();
+	success &= parseCustomLayoutMessages();
+	success &= parseWithReceiverFilter();
+	success &= parseFrameBehindForeignFalsePreamble();
+	success &= collectLinkStats();
+	success &= parseMessageInPlaceAndSplit();
+	success &= parseBatch();
+	success &= parseMessageAfterGarbage();
+	success &= parseFrameHiddenBehindFalsePreambles();
+	success &= parseGoodputWithBitErrors();
 
 	return !success;
 }